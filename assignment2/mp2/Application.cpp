@@ -26,13 +26,14 @@ void handler(int sig) {
  **********************************/
 int main(int argc, char *argv[]) {
 	//signal(SIGSEGV, handler);
-	if ( argc != ARGS_COUNT ) {
+	if ( argc != ARGS_COUNT && argc != ARGS_COUNT + 1 ) {
 		cout<<"Configuration (i.e., *.conf) file File Required"<<endl;
+		cout<<"Usage: "<<argv[0]<<" <conf> [node index to run in this process]"<<endl;
 		return FAILURE;
 	}
 
 	// Create a new application object
-	Application *app = new Application(argv[1]);
+	Application *app = new Application(argv[1], argc > ARGS_COUNT ? atoi(argv[2]) : -1);
 	// Call the run function
 	app->run();
 	// When done delete the application object
@@ -43,15 +44,77 @@ int main(int argc, char *argv[]) {
 
 /**
  * Constructor of the Application class
+ *
+ * self is the index of the only node this process runs, or -1 to run all of them.
+ * Nodes run in separate processes always talk over UDP.
+ * With more than one WORKERS, the nodes are split between that many forked worker
+ * processes talking over shared memory.
  */
-Application::Application(char *infile) {
+Application::Application(char *infile, int self) {
 	int i;
+	tick = NULL;
+	threads = NULL;
 	par = new Params();
-	srand (time(NULL));
 	par->setparams(infile);
+	Node::ringSize = par->RING_SIZE;
+	rng.seed(par->SEED, APP_STREAM, 0);
+	cout<<"Random seed: "<<par->SEED<<endl;
+	workload = new Workload(par);
+	if ( self >= par->EN_GPSZ ) {
+		cout<<"Node index "<<self<<" out of range, the test case has "<<par->EN_GPSZ<<" nodes"<<endl;
+		exit(1);
+	}
+	par->SELF = self;
+	// Nobody would see the operations of all the processes to add them up
+	if ( self >= 0 && workload->enabled() ) {
+		cout<<"A workload runs with all the nodes in one process, or split over WORKERS"<<endl;
+		exit(1);
+	}
+	if ( !par->REPLAY.empty() ) {
+		// A replay feeds the trace to every node of this one process
+		if ( self >= 0 ) {
+			cout<<"A replay runs all the nodes in one process"<<endl;
+			exit(1);
+		}
+		par->TRANSPORT = EMULNET_TRANSPORT;
+		par->WORKERS = 1;
+	}
+	if ( self >= 0 ) {
+		par->TRANSPORT = UDP_TRANSPORT;
+		if ( 0 == par->UDP_TICK_MS ) {
+			par->UDP_TICK_MS = UDPTICKMS;
+		}
+	}
+	else if ( par->WORKERS > 1 ) {
+		par->TRANSPORT = SHM_TRANSPORT;
+	}
+	// Threads and events step the nodes of one process over the emulated network only
+	if ( EMULNET_TRANSPORT != par->TRANSPORT || !par->REPLAY.empty() ) {
+		par->THREADS = 1;
+		par->SCHEDULER = TICK_SCHEDULER;
+	}
+	if ( par->THREADS > 1 ) {
+		threads = new ThreadPool(par->THREADS);
+		logLines.resize(par->EN_GPSZ);
+	}
 	log = new Log(par);
-	en = new EmulNet(par);
-	en1 = new EmulNet(par);
+	if ( UDP_TRANSPORT == par->TRANSPORT ) {
+		// The MP2 network takes the ports right above those of the MP1 network
+		en = new UdpNet(par, par->UDP_BASEPORT, 0);
+		en1 = new UdpNet(par, par->UDP_BASEPORT + par->EN_GPSZ + 1, 1);
+	}
+	else if ( SHM_TRANSPORT == par->TRANSPORT ) {
+		en = new ShmNet(par, par->WORKERS, par->SHM_RING_BYTES, 0);
+		en1 = new ShmNet(par, par->WORKERS, par->SHM_RING_BYTES, 1);
+		if ( par->WORKERS > 1 ) {
+			forkWorkers();
+			workload->slice();
+		}
+	}
+	else {
+		en = new EmulNet(par, 0);
+		en1 = new EmulNet(par, 1);
+	}
 	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
 	mp2 = (MP2Node **) malloc(par->EN_GPSZ * sizeof(MP2Node *));
 
@@ -67,8 +130,10 @@ Application::Application(char *infile) {
 		addressOfMemberNode = (Address *) en->ENinit(addressOfMemberNode, par->PORTNUM);
 		mp1[i] = new MP1Node(memberNode, par, en, log, addressOfMemberNode);
 		mp2[i] = new MP2Node(memberNode, par, en1, log, addressOfMemberNode);
-		log->LOG(&(mp1[i]->getMemberNode()->addr), "APP");
-		log->LOG(&(mp2[i]->getMemberNode()->addr), "APP MP2");
+		if ( par->runsNode(i) ) {
+			log->LOG(&(mp1[i]->getMemberNode()->addr), "APP");
+			log->LOG(&(mp2[i]->getMemberNode()->addr), "APP MP2");
+		}
 		delete addressOfMemberNode;
 	}
 }
@@ -78,17 +143,61 @@ Application::Application(char *infile) {
  */
 Application::~Application() {
 	delete log;
-	delete en;
-	delete en1;
+	// The nodes go first, as they may still hold buffers of the networks' pools
 	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
 		delete mp1[i];
 		delete mp2[i];
 	}
+	delete en;
+	delete en1;
+	delete threads;
+	delete workload;
 	free(mp1);
 	free(mp2);
+	if ( tick ) {
+		munmap(tick, sizeof(pthread_barrier_t));
+	}
 	delete par;
 }
 
+/**
+ * FUNCTION NAME: forkWorkers
+ *
+ * DESCRIPTION: Forks WORKERS - 1 copies of this process. Each of them, and this one as
+ * 				worker 0, goes on to run its own slice of the nodes in lock step with
+ * 				the others.
+ */
+void Application::forkWorkers() {
+	pthread_barrierattr_t attr;
+
+	tick = (pthread_barrier_t *) mmap(NULL, sizeof(pthread_barrier_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if ( MAP_FAILED == tick ) {
+		perror("mmap");
+		exit(1);
+	}
+	pthread_barrierattr_init(&attr);
+	pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(tick, &attr, par->WORKERS);
+	pthread_barrierattr_destroy(&attr);
+
+	// Flush before forking so nothing buffered gets written once per worker
+	fflush(stdout);
+	par->WORKER = 0;
+	for ( int k = 1; k < par->WORKERS; k++ ) {
+		pid_t pid = fork();
+		if ( pid < 0 ) {
+			perror("fork");
+			exit(1);
+		}
+		if ( 0 == pid ) {
+			par->WORKER = k;
+			workers.clear();
+			return;
+		}
+		workers.push_back(pid);
+	}
+}
+
 /**
  * FUNCTION NAME: run
  *
@@ -100,10 +209,15 @@ int Application::run()
 	int timeWhenAllNodesHaveJoined = 0;
 	// boolean indicating if all nodes have joined
 	bool allNodesJoined = false;
-	srand(time(NULL));
+
+	if ( !par->REPLAY.empty() ) {
+		return replay();
+	}
 
 	// As time runs along
-	for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
+	for( par->globaltime = 0; par->globaltime < par->TOTAL_RUNNING_TIME; ++par->globaltime ) {
+		waitForTick();
+
 		// Run the membership protocol
 		mp1Run();
 
@@ -123,14 +237,226 @@ int Application::run()
 	// Clean up
 	en->ENcleanup();
 	en1->ENcleanup();
+	writeQueueDepths();
+	workload->report();
 
 	for(i=0;i<=par->EN_GPSZ-1;i++) {
-		 mp1[i]->finishUpThisNode();
+		if ( par->runsNode(i) ) {
+			mp1[i]->finishUpThisNode();
+		}
+	}
+
+	for ( i = 0; i < (int)workers.size(); i++ ) {
+		waitpid(workers[i], NULL, 0);
+	}
+	if ( 0 == par->WORKER ) {
+		workload->reportTotal();
 	}
 
 	return SUCCESS;
 }
 
+/**
+ * FUNCTION NAME: replay
+ *
+ * DESCRIPTION: Runs the KV store message handlers over a trace captured on the MP2 network
+ * 				instead of running the test case. Neither the membership protocol nor the
+ * 				test driver run: each captured message is put straight into the queue of
+ * 				its destination in the tick the network would have handed it over, and
+ * 				what the handlers send in response is thrown away, as the trace already
+ * 				holds the responses of the captured run.
+ * 				Replies land on nodes with no pending transactions, so they exercise the
+ * 				lookup but not the quorum logic of the coordinators.
+ */
+int Application::replay() {
+	CaptureReader reader(par->REPLAY);
+	cap_rec *rec;
+	char *payload;
+	// (tick the message is handed over in, record), in the order the messages were sent
+	vector< pair<int, cap_rec *> > trace;
+	struct timespec start, end;
+	double handlerms = 0;
+	int i;
+
+	if ( 1 != reader.getNetId() ) {
+		cout<<par->REPLAY<<" was not captured on the MP2 network"<<endl;
+		exit(1);
+	}
+	while ( reader.next(&rec, &payload) ) {
+		// A message sent in tick t is received at the earliest in tick t + 1
+		trace.push_back(make_pair(max(rec->due, rec->tick + 1), rec));
+	}
+	stable_sort(trace.begin(), trace.end(), [](const pair<int, cap_rec *> &a, const pair<int, cap_rec *> &b) {
+		return a.first < b.first;
+	});
+
+	unsigned int next = 0;
+	while ( next < trace.size() ) {
+		par->globaltime = trace[next].first;
+
+		for ( ; next < trace.size() && trace[next].first == par->getcurrtime(); next++ ) {
+			rec = trace[next].second;
+			int to = *(int *)(rec->to);
+			if ( to < 1 || to > par->EN_GPSZ ) {
+				continue;
+			}
+			MsgBuffer *buf = en1->ENalloc(rec->size);
+			memcpy(buf->data(), (char *)(rec + 1), rec->size);
+			Queue::enqueue(&(mp2[to - 1]->getMemberNode()->mp2q), buf, rec->hdr);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for ( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+			mp2[i]->checkMessages();
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		handlerms += (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+
+		for ( i = 0; i < par->EN_GPSZ; i++ ) {
+			en1->ENrecv(&(mp2[i]->getMemberNode()->addr), discardWrapper, NULL, 1, NULL);
+		}
+	}
+	par->globaltime++;
+
+	cout<<"Replayed "<<trace.size()<<" messages of "<<par->REPLAY<<", handlers took "<<handlerms<<" ms"<<endl;
+
+	en->ENcleanup();
+	en1->ENcleanup();
+	writeQueueDepths();
+
+	return SUCCESS;
+}
+
+/**
+ * FUNCTION NAME: discardWrapper
+ *
+ * DESCRIPTION: Drops a message the handlers sent during a replay
+ */
+int Application::discardWrapper(void *env, MsgBuffer *buff, int hdr) {
+	buff->release();
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: writeQueueDepths
+ *
+ * DESCRIPTION: With a CPU_BUDGET, writes percentiles of the depth each MP2 node's queue had
+ * 				when it came to handle it, per node and over all of them
+ */
+void Application::writeQueueDepths() {
+	vector<long> all;
+
+	if ( par->CPU_BUDGET <= 0 ) {
+		return;
+	}
+	FILE *file = fopen((par->filePrefix() + "queue.log").c_str(), "w");
+	if ( NULL == file ) {
+		perror("queue.log");
+		return;
+	}
+	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( !par->runsNode(i) ) {
+			continue;
+		}
+		vector<long> &hist = mp2[i]->getDepthHistogram();
+		if ( hist.size() > all.size() ) {
+			all.resize(hist.size(), 0);
+		}
+		for ( unsigned int d = 0; d < hist.size(); d++ ) {
+			all[d] += hist[d];
+		}
+		fprintf(file, "node %3d queue depth p50 %d  p90 %d  p99 %d  max %d\n", i + 1, depthPercentile(hist, 0.5), depthPercentile(hist, 0.9), depthPercentile(hist, 0.99), (int)hist.size() - 1);
+	}
+	fprintf(file, "all      queue depth p50 %d  p90 %d  p99 %d  max %d\n", depthPercentile(all, 0.5), depthPercentile(all, 0.9), depthPercentile(all, 0.99), (int)all.size() - 1);
+	fclose(file);
+}
+
+/**
+ * FUNCTION NAME: depthPercentile
+ *
+ * DESCRIPTION: Smallest depth at least a fraction p of the samples in hist are at or below
+ */
+int Application::depthPercentile(vector<long> &hist, double p) {
+	long total = 0, seen = 0;
+
+	for ( unsigned int d = 0; d < hist.size(); d++ ) {
+		total += hist[d];
+	}
+	for ( unsigned int d = 0; d < hist.size(); d++ ) {
+		seen += hist[d];
+		if ( seen > 0 && seen >= p * total ) {
+			return d;
+		}
+	}
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: waitForTick
+ *
+ * DESCRIPTION: Holds the current tick back until every worker has finished the previous one
+ * 				and has taken in what the others sent it, and until its wall-clock start
+ * 				when ticks are paced, picking up the datagrams that arrive in the meantime
+ */
+void Application::waitForTick() {
+	static long start = 0;
+	struct timespec ts;
+	long now, deadline;
+
+	if ( tick ) {
+		pthread_barrier_wait(tick);
+		en->ENpoll(0);
+		en1->ENpoll(0);
+		// Nobody sends anything new before everybody has emptied their rings
+		pthread_barrier_wait(tick);
+	}
+
+	if ( par->UDP_TICK_MS <= 0 ) {
+		return;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	now = ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+	if ( 0 == start ) {
+		start = par->UDP_START > 0 ? par->UDP_START * 1000L : now;
+	}
+
+	deadline = start + (long)par->getcurrtime() * par->UDP_TICK_MS;
+	while ( now < deadline ) {
+		en->ENpoll(0);
+		en1->ENpoll(1);
+		clock_gettime(CLOCK_REALTIME, &ts);
+		now = ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+	}
+}
+
+/**
+ * FUNCTION NAME: stepNodes
+ *
+ * DESCRIPTION: Runs step on every node index in order, spread over the threads.
+ * 				What the nodes send and log is held back until all of them are done,
+ * 				then sent and written node by node in order, so the run comes out as
+ * 				if the steps had run one after another.
+ */
+void Application::stepNodes(vector<int> &order, const std::function<void(int)> &step) {
+	en->ENstage(true);
+	en1->ENstage(true);
+	threads->run(order.size(), [&](int k) {
+		Log::pending = &logLines[order[k]];
+		step(order[k]);
+		Log::pending = NULL;
+	});
+	en->ENstage(false);
+	en1->ENstage(false);
+
+	for ( unsigned int k = 0; k < order.size(); k++ ) {
+		Address *addr = &(mp1[order[k]]->getMemberNode()->addr);
+		log->flushLines(logLines[order[k]]);
+		en->ENcommit(addr);
+		en1->ENcommit(addr);
+	}
+}
+
 /**
  * FUNCTION NAME: mp1Run
  *
@@ -139,13 +465,47 @@ int Application::run()
 void Application::mp1Run() {
 	int i;
 
+	if ( threads ) {
+		vector<int> order;
+		for ( i = 0; i <= par->EN_GPSZ-1; i++ ) {
+			if ( par->runsNode(i) && par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+				order.push_back(i);
+			}
+		}
+		stepNodes(order, [&](int i) {
+			mp1[i]->recvLoop();
+		});
+
+		// The nodes introduced now have the highest indices, so they come first anyway
+		order.clear();
+		for ( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+			if ( par->getcurrtime() == (int)(par->STEP_RATE*i) ) {
+				mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
+				cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
+				nodeCount += i;
+			}
+			else if ( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+				order.push_back(i);
+			}
+		}
+		stepNodes(order, [&](int i) {
+			mp1[i]->nodeLoop();
+			#ifdef DEBUGLOG
+			if( (i == 0) && (par->globaltime % 500 == 0) ) {
+				log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
+			}
+			#endif
+		});
+		return;
+	}
+
 	// For all the nodes in the system
 	for( i = 0; i <= par->EN_GPSZ-1; i++) {
 
 		/*
 		 * Receive messages from the network and queue them in the membership protocol queue
 		 */
-		if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+		if( par->runsNode(i) && par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
 			// Receive messages from the network and queue them
 			mp1[i]->recvLoop();
 		}
@@ -154,6 +514,9 @@ void Application::mp1Run() {
 
 	// For all the nodes in the system
 	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+		if ( !par->runsNode(i) ) {
+			continue;
+		}
 
 		/*
 		 * Introduce nodes into the distributed system
@@ -191,44 +554,93 @@ void Application::mp1Run() {
  */
 void Application::mp2Run() {
 	int i;
+	// With the EVENT scheduler, a node only does what it has something to do for
+	bool events = EVENT_SCHEDULER == par->SCHEDULER;
+
+	if ( threads ) {
+		vector<int> order;
+		for ( i = 0; i <= par->EN_GPSZ-1; i++ ) {
+			if ( par->getcurrtime() > (int)(par->STEP_RATE*i) && !mp2[i]->getMemberNode()->bFailed ) {
+				order.push_back(i);
+			}
+		}
+		// What a node sends while updating its ring reaches the others in the next tick,
+		// even those that come after it here
+		stepNodes(order, [&](int i) {
+			if ( mp2[i]->getMemberNode()->inited && mp2[i]->getMemberNode()->inGroup && (!events || mp2[i]->ringDue()) ) {
+				mp2[i]->updateRing();
+			}
+			if ( !events || en1->ENpending(&mp2[i]->getMemberNode()->addr) ) {
+				mp2[i]->recvLoop();
+			}
+		});
+		reverse(order.begin(), order.end());
+		stepNodes(order, [&](int i) {
+			if ( !events || mp2[i]->busy() ) {
+				mp2[i]->checkMessages();
+			}
+			else {
+				mp2[i]->idleTick();
+			}
+		});
+	}
 
 	// For all the nodes in the system
-	for( i = 0; i <= par->EN_GPSZ-1; i++) {
+	for( i = 0; i <= par->EN_GPSZ-1 && !threads; i++) {
 
 		/*
 		 * 1) Update the ring
 		 * 2) Receive messages from the network and queue them in the KV store queue
 		 */
-		if ( par->getcurrtime() > (int)(par->STEP_RATE*i) && !mp2[i]->getMemberNode()->bFailed ) {
-			if ( mp2[i]->getMemberNode()->inited && mp2[i]->getMemberNode()->inGroup ) {
+		if ( par->runsNode(i) && par->getcurrtime() > (int)(par->STEP_RATE*i) && !mp2[i]->getMemberNode()->bFailed ) {
+			if ( mp2[i]->getMemberNode()->inited && mp2[i]->getMemberNode()->inGroup && (!events || mp2[i]->ringDue()) ) {
 				// Step 1
 				mp2[i]->updateRing();
 			}
 			// Step 2
-			mp2[i]->recvLoop();
+			if ( !events || en1->ENpending(&mp2[i]->getMemberNode()->addr) ) {
+				mp2[i]->recvLoop();
+			}
 		}
 	}
 
 	/**
 	 * Handle messages from the queue and update the DHT
 	 */
-	for ( i = par->EN_GPSZ-1; i >= 0; i-- ) {
-		if ( par->getcurrtime() > (int)(par->STEP_RATE*i) && !mp2[i]->getMemberNode()->bFailed ) {
-			mp2[i]->checkMessages();
+	for ( i = par->EN_GPSZ-1; i >= 0 && !threads; i-- ) {
+		if ( par->runsNode(i) && par->getcurrtime() > (int)(par->STEP_RATE*i) && !mp2[i]->getMemberNode()->bFailed ) {
+			if ( !events || mp2[i]->busy() ) {
+				mp2[i]->checkMessages();
+			}
+			else {
+				mp2[i]->idleTick();
+			}
 		}
 	}
 
 	/**
 	 * Insert a set of test key value pairs into the system
 	 */
-	if ( par->getcurrtime() == INSERT_TIME ) {
+	if ( par->runsNode(0) && par->getcurrtime() == par->INSERT_TIME ) {
 		insertTestKVPairs();
 	}
 
+	/**
+	 * Put the load of the test case on the system; each worker puts on the share of its nodes
+	 */
+	runWorkload();
+
+	/**
+	 * The tests are driven from node 0 when nodes run in separate processes
+	 */
+	if ( !par->runsNode(0) ) {
+		return;
+	}
+
 	/**
 	 * Test CRUD operations
 	 */
-	if ( par->getcurrtime() >= TEST_TIME ) {
+	if ( par->getcurrtime() >= par->TEST_TIME ) {
 		/**************
 		 * CREATE TEST
 		 **************/
@@ -236,7 +648,7 @@ void Application::mp2Run() {
 		 * TEST 1: Checks if there are RF * NUMBER_OF_INSERTS CREATE SUCCESS message are in the log
 		 *
 		 */
-		if ( par->getcurrtime() == TEST_TIME && CREATE_TEST == par->CRUDTEST ) {
+		if ( par->getcurrtime() == par->TEST_TIME && CREATE_TEST == par->CRUDTEST ) {
 			cout<<endl<<"Doing create test at time: "<<par->getcurrtime()<<endl;
 		} // End of create test
 
@@ -249,7 +661,7 @@ void Application::mp2Run() {
 		 * TEST 2: Delete a non-existent key. Check for a DELETE FAIL message in the lgo
 		 *
 		 */
-		else if ( par->getcurrtime() == TEST_TIME && DELETE_TEST == par->CRUDTEST ) {
+		else if ( par->getcurrtime() == par->TEST_TIME && DELETE_TEST == par->CRUDTEST ) {
 			deleteTest();
 		} // End of delete test
 
@@ -284,8 +696,10 @@ void Application::mp2Run() {
 		 * TEST 5: Read a non-existent key. Check for a READ FAIL message in the log
 		 *
 		 */
-		else if ( par->getcurrtime() >= TEST_TIME && READ_TEST == par->CRUDTEST ) {
-			readTest();
+		else if ( par->getcurrtime() >= par->TEST_TIME && READ_TEST == par->CRUDTEST ) {
+			if ( canFailNodes() ) {
+				readTest();
+			}
 		} // end of read test
 
 		/***************
@@ -319,13 +733,31 @@ void Application::mp2Run() {
 		 * TEST 5: Update a non-existent key. Check for a UPDATE FAIL message in the log
 		 *
 		 */
-		else if ( par->getcurrtime() >= TEST_TIME && UPDATE_TEST == par->CRUDTEST ) {
-			updateTest();
+		else if ( par->getcurrtime() >= par->TEST_TIME && UPDATE_TEST == par->CRUDTEST ) {
+			if ( canFailNodes() ) {
+				updateTest();
+			}
 		} // End of update test
 
 	} // end of if ( par->getcurrtime == TEST_TIME)
 }
 
+/**
+ * FUNCTION NAME: canFailNodes
+ *
+ * DESCRIPTION: The read and update tests fail replicas on the fly, which only works when
+ * 				every node runs in this process
+ */
+bool Application::canFailNodes() {
+	if ( par->SELF < 0 && par->WORKER < 0 ) {
+		return true;
+	}
+	if ( par->getcurrtime() == par->TEST_TIME ) {
+		cout<<endl<<"Skipping the test: it fails nodes, which run in other processes"<<endl;
+	}
+	return false;
+}
+
 /**
  * FUNCTION NAME: fail
  *
@@ -342,14 +774,14 @@ void Application::fail() {
 	}
 
 	if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
-		removed = (rand() % par->EN_GPSZ);
+		removed = rng.nextInt(par->EN_GPSZ);
 		#ifdef DEBUGLOG
 		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
 		#endif
 		mp1[removed]->getMemberNode()->bFailed = true;
 	}
 	else if( par->getcurrtime() == 100 ) {
-		removed = rand() % par->EN_GPSZ/2;
+		removed = rng.nextInt(par->EN_GPSZ)/2;
 		for ( i = removed; i < removed + par->EN_GPSZ/2; i++ ) {
 			#ifdef DEBUGLOG
 			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
@@ -385,30 +817,67 @@ Address Application::getjoinaddr(void){
  * DESCRTPTION: Finds a random node in the ring that is alive
  */
 int Application::findARandomNodeThatIsAlive() {
+	return findARandomNodeThatIsAlive(rng);
+}
+
+/**
+ * FUNCTION NAME: findARandomNodeThatIsAlive
+ *
+ * DESCRIPTION: Finds a random node in the ring that is alive, drawing from the stream from
+ */
+int Application::findARandomNodeThatIsAlive(Rng &from) {
 	int number;
 	do {
-		number = (rand()%par->EN_GPSZ);
-	}while (mp2[number]->getMemberNode()->bFailed);
+		number = from.nextInt(par->EN_GPSZ);
+	}while (mp2[number]->getMemberNode()->bFailed || !par->runsNode(number));
 	return number;
 }
 
+/**
+ * FUNCTION NAME: runWorkload
+ *
+ * DESCRIPTION: Issues the operations of the workload due in this tick, each from a random
+ * 				live node. The nodes are picked from the stream of the workload, so turning
+ * 				it on leaves the draws of the tests alone.
+ */
+void Application::runWorkload() {
+	vector<workload_op> ops;
+
+	workload->next(ops);
+	for ( unsigned int i = 0; i < ops.size(); i++ ) {
+		MP2Node *node = mp2[findARandomNodeThatIsAlive(workload->getRng())];
+		switch ( ops[i].type ) {
+			case READ_OP:
+				node->clientRead(ops[i].key);
+				break;
+			case UPDATE_OP:
+				node->clientUpdate(ops[i].key, ops[i].value);
+				break;
+			case INSERT_OP:
+				node->clientCreate(ops[i].key, ops[i].value);
+				break;
+			default:
+				node->clientDelete(ops[i].key);
+		}
+	}
+}
+
 /**
  * FUNCTION NAME: initTestKVPairs
  *
  * DESCRIPTION: Init NUMBER_OF_INSERTS test KV pairs in the map
  */
 void Application::initTestKVPairs() {
-	srand(time(NULL));
 	int i;
 	string key;
 	key.clear();
 	testKVPairs.clear();
 	int alphanumLen = sizeof(alphanum) - 1;
-	while ( testKVPairs.size() != NUMBER_OF_INSERTS ) {
-		for ( i = 0; i < KEY_LENGTH; i++ ) {
-			key.push_back(alphanum[rand()%alphanumLen]);
+	while ( (int)testKVPairs.size() != par->NUMBER_OF_INSERTS ) {
+		for ( i = 0; i < par->KEY_LENGTH; i++ ) {
+			key.push_back(alphanum[rng.nextInt(alphanumLen)]);
 		}
-		string value = "value" + to_string(rand()%NUMBER_OF_INSERTS);
+		string value = "value" + to_string(rng.nextInt(par->NUMBER_OF_INSERTS));
 		testKVPairs[key] = value;
 		key.clear();
 	}
@@ -494,7 +963,7 @@ void Application::readTest() {
 	/**
  	 * Test 1: Test if value of a single read operation is read correctly in quorum number of nodes
  	 */
-	if ( par->getcurrtime() == TEST_TIME ) {
+	if ( par->getcurrtime() == par->TEST_TIME ) {
 		// Step 1.a. Find a node that is alive
 		number = findARandomNodeThatIsAlive();
 
@@ -509,7 +978,7 @@ void Application::readTest() {
 	/**
 	 * Test 2: FAIL ONE REPLICA. Test if value is read correctly in quorum number of nodes after ONE OF THE REPLICAS IS FAILED
 	 */
-	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME) ) {
+	if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME) ) {
 		// Step 2.a Find a node that is alive and assign it as number
 		number = findARandomNodeThatIsAlive();
 
@@ -571,12 +1040,12 @@ void Application::readTest() {
 	 * Test 3 part 1: Fail two replicas. Test if value is read correctly in quorum number of nodes after TWO OF THE REPLICAS ARE FAILED
 	 */
 	// Wait for STABILIZE_TIME and fail two replicas
-	if ( par->getcurrtime() >= (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME) ) {
+	if ( par->getcurrtime() >= (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME) ) {
 		vector<int> nodesToFail;
 		nodesToFail.clear();
 		int count = 0;
 
-		if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME) ) {
+		if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME) ) {
 			// Step 3.a. Find a node that is alive
 			number = findARandomNodeThatIsAlive();
 
@@ -644,7 +1113,7 @@ void Application::readTest() {
 		 * TEST 3 part 2: After failing two replicas and waiting for STABILIZE_TIME, issue a read
 		 */
 		// Step 3.d Wait for stabilization protocol to kick in
-		if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME + STABILIZE_TIME) ) {
+		if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME + par->STABILIZE_TIME) ) {
 			number = findARandomNodeThatIsAlive();
 			// Step 3.e Issue a read
 			cout<<endl<<"Reading a valid key.... ... .. . ."<<endl;
@@ -659,7 +1128,7 @@ void Application::readTest() {
 	/**
 	 * Test 4: FAIL A NON-REPLICA. Test if value is read correctly in quorum number of nodes after a NON-REPLICA IS FAILED
 	 */
-	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME + STABILIZE_TIME + LAST_FAIL_TIME ) ) {
+	if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME + par->STABILIZE_TIME + par->LAST_FAIL_TIME ) ) {
 		// Step 4.a. Find a node that is alive
 		number = findARandomNodeThatIsAlive();
 
@@ -702,7 +1171,7 @@ void Application::readTest() {
 	/**
 	 * Test 5: Read a non-existent key.
 	 */
-	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME + STABILIZE_TIME + LAST_FAIL_TIME ) ) {
+	if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME + par->STABILIZE_TIME + par->LAST_FAIL_TIME ) ) {
 		string invalidKey = "invalidKey";
 
 		// Step 5.a Find a node that is alive
@@ -739,7 +1208,7 @@ void Application::updateTest() {
 	/**
 	 * Test 1: Test if value is updated correctly in quorum number of nodes
 	 */
-	if ( par->getcurrtime() == TEST_TIME ) {
+	if ( par->getcurrtime() == par->TEST_TIME ) {
 		// Step 1.a. Find a node that is alive
 		number = findARandomNodeThatIsAlive();
 
@@ -754,7 +1223,7 @@ void Application::updateTest() {
 	/**
 	 * Test 2: FAIL ONE REPLICA. Test if value is updated correctly in quorum number of nodes after ONE OF THE REPLICAS IS FAILED
 	 */
-	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME) ) {
+	if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME) ) {
 		// Step 2.a Find a node that is alive and assign it as number
 		number = findARandomNodeThatIsAlive();
 
@@ -815,13 +1284,13 @@ void Application::updateTest() {
 	/**
 	 * Test 3 part 1: Fail two replicas. Test if value is updated correctly in quorum number of nodes after TWO OF THE REPLICAS ARE FAILED
 	 */
-	if ( par->getcurrtime() >= (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME) ) {
+	if ( par->getcurrtime() >= (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME) ) {
 
 		vector<int> nodesToFail;
 		nodesToFail.clear();
 		int count = 0;
 
-		if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME) ) {
+		if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME) ) {
 			// Step 3.a. Find a node that is alive
 			number = findARandomNodeThatIsAlive();
 
@@ -886,7 +1355,7 @@ void Application::updateTest() {
 		 * TEST 3 part 2: After failing two replicas and waiting for STABILIZE_TIME, issue an update
 		 */
 		// Step 3.d Wait for stabilization protocol to kick in
-		if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME + STABILIZE_TIME) ) {
+		if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME + par->STABILIZE_TIME) ) {
 			number = findARandomNodeThatIsAlive();
 			// Step 3.e Issue a update
 			cout<<endl<<"Updating a valid key.... ... .. . ."<<endl;
@@ -901,7 +1370,7 @@ void Application::updateTest() {
 	/**
 	 * Test 4: FAIL A NON-REPLICA. Test if value is read correctly in quorum number of nodes after a NON-REPLICA IS FAILED
 	 */
-	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME + STABILIZE_TIME + LAST_FAIL_TIME ) ) {
+	if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME + par->STABILIZE_TIME + par->LAST_FAIL_TIME ) ) {
 		// Step 4.a. Find a node that is alive
 		number = findARandomNodeThatIsAlive();
 
@@ -945,7 +1414,7 @@ void Application::updateTest() {
 	/**
 	 * Test 5: Udpate a non-existent key.
 	 */
-	if ( par->getcurrtime() == (TEST_TIME + FIRST_FAIL_TIME + STABILIZE_TIME + STABILIZE_TIME + LAST_FAIL_TIME ) ) {
+	if ( par->getcurrtime() == (par->TEST_TIME + par->FIRST_FAIL_TIME + par->STABILIZE_TIME + par->STABILIZE_TIME + par->LAST_FAIL_TIME ) ) {
 		string invalidKey = "invalidKey";
 		string invalidValue = "invalidValue";
 
@@ -13,6 +13,12 @@
 #include "Params.h"
 #include "Member.h"
 #include "EmulNet.h"
+#include "UdpNet.h"
+#include "ShmNet.h"
+#include "ThreadPool.h"
+#include "Workload.h"
+#include <pthread.h>
+#include <sys/wait.h>
 #include "Queue.h"
 #include "MP2Node.h"
 #include "Node.h"
@@ -21,7 +27,7 @@
 /**
  * global variables
  */
-int nodeCount = 0;
+long nodeCount = 0;
 static const char alphanum[] =
 "0123456789"
 "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -31,15 +37,9 @@ static const char alphanum[] =
  * Macros
  */
 #define ARGS_COUNT 2
-#define TOTAL_RUNNING_TIME 700
-#define INSERT_TIME (TOTAL_RUNNING_TIME-600)
-#define TEST_TIME (INSERT_TIME+50)
-#define STABILIZE_TIME 50
-#define FIRST_FAIL_TIME 25
-#define LAST_FAIL_TIME 10
+// Replicas of every key; the ring keeps two predecessors and two successors per node,
+// so unlike the rest of the run shape this one is not a parameter of the test case
 #define RF 3
-#define NUMBER_OF_INSERTS 100
-#define KEY_LENGTH 5
 
 /**
  * CLASS NAME: Application
@@ -58,17 +58,39 @@ private:
 	MP2Node **mp2;
 	Params *par;
 	map<string, string> testKVPairs;
+	// Random stream of the test driver
+	Rng rng;
+	// Barrier the worker processes meet at between ticks, NULL with a single process
+	pthread_barrier_t *tick;
+	// Worker processes forked by this one
+	vector<pid_t> workers;
+	// Threads stepping the nodes of a phase, NULL to step them one by one
+	ThreadPool *threads;
+	// Lines each node logged in the phase being stepped
+	vector<log_lines> logLines;
+	// Load put on the KV store next to the tests
+	Workload *workload;
 public:
-	Application(char *);
+	Application(char *, int self = -1);
 	virtual ~Application();
 	Address getjoinaddr();
 	void initTestKVPairs();
 	int run();
+	int replay();
+	static int discardWrapper(void *env, MsgBuffer *buff, int hdr);
+	void writeQueueDepths();
+	int depthPercentile(vector<long> &hist, double p);
+	void forkWorkers();
+	void waitForTick();
+	bool canFailNodes();
+	void stepNodes(vector<int> &order, const std::function<void(int)> &step);
 	void mp1Run();
 	void mp2Run();
 	void fail();
 	void insertTestKVPairs();
 	int findARandomNodeThatIsAlive();
+	int findARandomNodeThatIsAlive(Rng &from);
+	void runWorkload();
 	void deleteTest();
 	void readTest();
 	void updateTest();
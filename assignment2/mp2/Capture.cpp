@@ -0,0 +1,148 @@
+/**********************************
+ * FILE NAME: Capture.cpp
+ *
+ * DESCRIPTION: Definition of the CaptureWriter and CaptureReader classes
+ **********************************/
+
+#include "Capture.h"
+
+/**
+ * Constructor
+ */
+CaptureWriter::CaptureWriter(string path, int netId): used(0) {
+	cap_file_hdr hdr;
+
+	fp = fopen(path.c_str(), "wb");
+	if ( NULL == fp ) {
+		fprintf(stderr, "Could not open capture file %s: %s\n", path.c_str(), strerror(errno));
+		exit(1);
+	}
+	buf.resize(CAPTURE_BUFSIZE);
+
+	memset(&hdr, 0, sizeof(hdr));
+	strcpy(hdr.magic, CAPTURE_MAGIC);
+	hdr.version = CAPTURE_VERSION;
+	hdr.netId = netId;
+	append(&hdr, sizeof(hdr));
+}
+
+/**
+ * Destructor
+ */
+CaptureWriter::~CaptureWriter() {
+	flush();
+	fclose(fp);
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Adds len bytes to the buffer, writing it out first if they do not fit
+ */
+void CaptureWriter::append(const void *data, size_t len) {
+	if ( used + len > buf.size() ) {
+		flush();
+	}
+	if ( len > buf.size() ) {
+		fwrite(data, 1, len, fp);
+		return;
+	}
+	memcpy(&buf[used], data, len);
+	used += len;
+}
+
+/**
+ * FUNCTION NAME: record
+ *
+ * DESCRIPTION: Appends one message
+ */
+void CaptureWriter::record(int tick, int due, Address *from, Address *to, int hdr, char *payload, int size) {
+	static const char padding[8] = {0};
+	cap_rec rec;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.tick = tick;
+	rec.due = due;
+	rec.size = size;
+	rec.hdr = hdr;
+	memcpy(rec.from, from->addr, sizeof(rec.from));
+	memcpy(rec.to, to->addr, sizeof(rec.to));
+
+	append(&rec, sizeof(rec));
+	append(payload, size);
+	append(padding, (8 - size % 8) % 8);
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Writes out the buffered bytes
+ */
+void CaptureWriter::flush() {
+	if ( used > 0 ) {
+		fwrite(&buf[0], 1, used, fp);
+		used = 0;
+	}
+	fflush(fp);
+}
+
+/**
+ * Constructor
+ */
+CaptureReader::CaptureReader(string path): map(NULL), len(0), off(sizeof(cap_file_hdr)) {
+	struct stat st;
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if ( fd < 0 || fstat(fd, &st) < 0 ) {
+		fprintf(stderr, "Could not open capture file %s: %s\n", path.c_str(), strerror(errno));
+		exit(1);
+	}
+	len = st.st_size;
+	if ( len >= sizeof(cap_file_hdr) ) {
+		map = (char *) mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+
+	if ( NULL == map || MAP_FAILED == map || 0 != strcmp(((cap_file_hdr *)map)->magic, CAPTURE_MAGIC) ) {
+		fprintf(stderr, "%s is not a capture file\n", path.c_str());
+		exit(1);
+	}
+}
+
+/**
+ * Destructor
+ */
+CaptureReader::~CaptureReader() {
+	munmap(map, len);
+}
+
+/**
+ * FUNCTION NAME: getNetId
+ *
+ * DESCRIPTION: EmulNet the captured messages were sent on
+ */
+int CaptureReader::getNetId() {
+	return ((cap_file_hdr *)map)->netId;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Points rec and payload at the next record, in place in the mapping
+ *
+ * RETURNS:
+ * false at the end of the file
+ */
+bool CaptureReader::next(cap_rec **rec, char **payload) {
+	if ( off + sizeof(cap_rec) > len ) {
+		return false;
+	}
+	*rec = (cap_rec *)(map + off);
+	if ( off + sizeof(cap_rec) + (*rec)->size > len ) {
+		// Cut short, e.g. by a run that did not finish
+		return false;
+	}
+	*payload = map + off + sizeof(cap_rec);
+	off += sizeof(cap_rec) + (((*rec)->size + 7) & ~7);
+	return true;
+}
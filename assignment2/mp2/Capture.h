@@ -0,0 +1,90 @@
+/**********************************
+ * FILE NAME: Capture.h
+ *
+ * DESCRIPTION: Header file of the CaptureWriter and CaptureReader classes
+ **********************************/
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Macros
+ */
+#define CAPTURE_MAGIC "ENCAP01"
+#define CAPTURE_VERSION 1
+// Bytes gathered in memory before they are written out
+#define CAPTURE_BUFSIZE (1024 * 1024)
+
+/**
+ * Struct Name: cap_file_hdr
+ *
+ * DESCRIPTION: First bytes of a capture file
+ */
+typedef struct cap_file_hdr {
+	char magic[8];
+	int version;
+	// EmulNet the messages were sent on, 0 for MP1 and 1 for MP2
+	int netId;
+}cap_file_hdr;
+
+/**
+ * Struct Name: cap_rec
+ *
+ * DESCRIPTION: Header of one captured message. The payload follows it, padded so that
+ * 				the next record starts 8-byte aligned and the file can be read in place
+ * 				from an mmap.
+ */
+typedef struct cap_rec {
+	// Tick the message was sent in
+	int tick;
+	// Tick it was due at the receiver
+	int due;
+	int size;
+	// Per-destination header word
+	int hdr;
+	char from[6];
+	char to[6];
+	int unused;
+}cap_rec;
+
+/**
+ * CLASS NAME: CaptureWriter
+ *
+ * DESCRIPTION: Appends captured messages to a file through a large in-memory buffer
+ */
+class CaptureWriter {
+private:
+	FILE *fp;
+	vector<char> buf;
+	size_t used;
+	void append(const void *data, size_t len);
+public:
+	CaptureWriter(string path, int netId);
+	virtual ~CaptureWriter();
+	void record(int tick, int due, Address *from, Address *to, int hdr, char *payload, int size);
+	void flush();
+};
+
+/**
+ * CLASS NAME: CaptureReader
+ *
+ * DESCRIPTION: Walks the records of a capture file mapped into memory
+ */
+class CaptureReader {
+private:
+	char *map;
+	size_t len;
+	size_t off;
+public:
+	CaptureReader(string path);
+	virtual ~CaptureReader();
+	int getNetId();
+	bool next(cap_rec **rec, char **payload);
+};
+
+#endif /* CAPTURE_H_ */
@@ -0,0 +1,66 @@
+#!/bin/bash
+
+#################################################
+# FILE NAME: CompareRuns.sh
+#
+# DESCRIPTION: Checks that two test cases, run on the same seed, write the
+#              same dbg.log, msgcount.log and, with a CPU_BUDGET, queue.log,
+#              e.g. that SCHEDULER: EVENT changes how a run is stepped but
+#              not what it does.
+#              With -d only dbg.log is compared. THREADS needs it: the MP2
+#              stabilization messages reach every node in the next tick, so
+#              msgcount.log counts some of them a tick later.
+#
+# RUN PROCEDURE:
+# $ chmod +x CompareRuns.sh
+# $ ./CompareRuns.sh [-d] <conf> <conf> [seed]
+# $ ./CompareRuns.sh ./testcases/read.conf ./testcases/read-event.conf
+# $ ./CompareRuns.sh -d ./testcases/read.conf ./testcases/read-threads.conf
+#################################################
+
+LOGS="dbg msgcount queue"
+if [ "$1" == "-d" ]
+then
+	LOGS="dbg"
+	shift
+fi
+
+if [ $# -lt 2 ]
+then
+	echo "Usage: $0 [-d] <conf> <conf> [seed]"
+	exit 1
+fi
+
+SEED=${3:-1}
+OUT=`mktemp -d`
+
+for run in 1 2
+do
+	# A key given twice takes its last value, so the seed overrides any in the test case
+	conf=${!run}
+	( cat "${conf}"; echo ""; echo "SEED: ${SEED}" ) > ${OUT}/${run}.conf
+	rm -f queue.log
+	./Application ${OUT}/${run}.conf > /dev/null 2>&1
+	cp dbg.log ${OUT}/${run}.dbg.log
+	# The peak of the buffer pools depends on how the run was stepped
+	grep -v "^in-flight" msgcount.log > ${OUT}/${run}.msgcount.log
+	touch queue.log
+	cp queue.log ${OUT}/${run}.queue.log
+done
+
+STATUS=0
+for log in ${LOGS}
+do
+	if ! cmp -s ${OUT}/1.${log}.log ${OUT}/2.${log}.log
+	then
+		echo "${log}.log differs between $1 and $2 on seed ${SEED}"
+		STATUS=1
+	fi
+done
+rm -rf ${OUT}
+
+if [ ${STATUS} -eq 0 ]
+then
+	echo "Same logs for $1 and $2 on seed ${SEED}"
+fi
+exit ${STATUS}
@@ -8,19 +8,35 @@
 
 /**
  * Constructor
+ *
+ * netId tells the random streams of different networks apart
  */
-EmulNet::EmulNet(Params *p)
+EmulNet::EmulNet(Params *p, int netId)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
+	pool = make_shared<MsgPool>();
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
+	sent_msgs.resize(par->EN_GPSZ + 1);
+	recv_msgs.resize(par->EN_GPSZ + 1);
+	this->netId = netId;
+	// Sized up front, so that nodes stepped in parallel never grow it
+	for ( int i = 0; i <= par->EN_GPSZ; i++ ) {
+		rngs.push_back(Rng(par->SEED, NET_STREAM + netId, i));
+	}
+	faults.init(par->FAULTS, par->EN_GPSZ);
+	// Nodes stepped in parallel each touch only their own row of these
+	staging = false;
+	staged.resize(par->EN_GPSZ + 1);
+	freed.resize(par->EN_GPSZ + 1);
+	emulnet.getMailbox(par->EN_GPSZ);
+	if ( par->THREADS > 1 ) {
+		pool->setLocked(true);
+		for ( int i = 1; i < par->THREADS; i++ ) {
+			threadPools.push_back(make_shared<MsgPool>());
+			threadPools.back()->setLocked(true);
 		}
 	}
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
@@ -30,15 +46,20 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->pool = anotherEmulNet.pool;
+	this->threadPools = anotherEmulNet.threadPools;
+	this->staging = anotherEmulNet.staging;
+	this->staged = anotherEmulNet.staged;
+	this->freed = anotherEmulNet.freed;
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->traffic = anotherEmulNet.traffic;
+	this->rngs = anotherEmulNet.rngs;
+	this->netId = anotherEmulNet.netId;
+	this->capture = anotherEmulNet.capture;
+	this->faults = anotherEmulNet.faults;
 	this->emulnet = anotherEmulNet.emulnet;
 }
 
@@ -46,15 +67,20 @@ EmulNet::EmulNet(EmulNet &anotherEmulNet) {
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->pool = anotherEmulNet.pool;
+	this->threadPools = anotherEmulNet.threadPools;
+	this->staging = anotherEmulNet.staging;
+	this->staged = anotherEmulNet.staged;
+	this->freed = anotherEmulNet.freed;
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->traffic = anotherEmulNet.traffic;
+	this->rngs = anotherEmulNet.rngs;
+	this->netId = anotherEmulNet.netId;
+	this->capture = anotherEmulNet.capture;
+	this->faults = anotherEmulNet.faults;
 	this->emulnet = anotherEmulNet.emulnet;
 	return *this;
 }
@@ -73,50 +99,229 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
 	// Initialize data structures for this member
 	*(int *)(myaddr->addr) = emulnet.nextid++;
     *(short *)(&myaddr->addr[4]) = 0;
+	// Make room for this node's mailbox up front
+	emulnet.getMailbox(*(int *)(myaddr->addr));
 	return myaddr;
 }
 
+/**
+ * FUNCTION NAME: ENalloc
+ *
+ * DESCRIPTION: Returns a pooled buffer of size bytes for the caller to build a message in.
+ * 				The buffer is handed over to EmulNet by ENsend.
+ * 				Each thread of the ThreadPool allocates from a pool of its own.
+ */
+MsgBuffer *EmulNet::ENalloc(int size) {
+	int thread = ThreadPool::current();
+	if ( thread > 0 && thread <= (int)threadPools.size() ) {
+		return threadPools[thread - 1]->allocBuffer(size);
+	}
+	return pool->allocBuffer(size);
+}
+
 /**
  * FUNCTION NAME: ENsend
  *
  * DESCRIPTION: EmulNet send function
+ * 				Takes over the caller's reference to buf, whether or not the message is sent.
+ * 				The payload is not copied; the receiver gets the same buffer, along with hdr.
+ * 				With LINK_CREDITS set, each message takes a credit of its link until the
+ * 				receiver takes it in; callers that can wait should check ENcredits first.
+ *
+ * 				While staging, the message is only held for ENcommit, and counted as sent.
  *
  * RETURNS:
- * size
+ * size, 0 if the message was dropped, or EN_BACKPRESSURE if the link had no credit left
  */
-int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-	en_msg *em;
+int EmulNet::ENsend(Address *myaddr, Address *toaddr, MsgBuffer *buf, int hdr) {
+	en_msg em;
 	static char temp[2048];
-	int sendmsg = rand() % 100;
-
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
-		return 0;
+	int size = buf->size;
+
+	if ( staging ) {
+		staged_msg sm;
+		sm.to = *toaddr;
+		sm.buf = buf;
+		sm.hdr = hdr;
+		sm.event = SENT_TRAFFIC;
+		staged[*(int *)(myaddr->addr)].push_back(sm);
+		return size;
 	}
+	int sendmsg = rngOf(*(int *)(myaddr->addr)).nextInt(100);
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
-	em->size = size;
-
-	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
-	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
+	if ( ENcredits(myaddr, toaddr) <= 0 ) {
+		dropMsg(myaddr, buf, NO_CREDIT_DROP);
+		return EN_BACKPRESSURE;
+	}
+	if ( par->EN_BUFFSIZE > 0 && emulnet.currbuffsize >= par->EN_BUFFSIZE ) {
+		return dropMsg(myaddr, buf, BUFFER_FULL_DROP);
+	}
+	if ( size + (int)sizeof(MsgBuffer) >= par->MAX_MSG_SIZE ) {
+		return dropMsg(myaddr, buf, OVERSIZE_DROP);
+	}
+	if ( par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100) ) {
+		return dropMsg(myaddr, buf, RANDOM_DROP);
+	}
+	int fault = linkFault(myaddr, toaddr, buf);
+	if ( SENT_TRAFFIC != fault ) {
+		return dropMsg(myaddr, buf, fault);
+	}
 
-	emulnet.buff[emulnet.currbuffsize++] = em;
+	em.size = size;
+	em.from = *myaddr;
+	em.to = *toaddr;
+	em.buf = buf;
+	em.hdr = hdr;
+
+	int due = sendDue(myaddr, toaddr, size);
+	captureMsg(myaddr, toaddr, buf, hdr, due);
+	countTraffic(myaddr, buf, SENT_TRAFFIC);
+	if ( par->LINK_CREDITS > 0 ) {
+		addInflight(*(int *)(myaddr->addr), *(int *)(toaddr->addr), 1);
+	}
+	deliver(em, due);
 
 	int src = *(int *)(myaddr->addr);
 	int time = par->getcurrtime();
 
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
-
-	sent_msgs[src][time]++;
+	countMsg(sent_msgs, src, time);
 
 	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
+		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)buf->data(), toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
 	#endif
 
 	return size;
 }
 
+/**
+ * FUNCTION NAME: ENmulticast
+ *
+ * DESCRIPTION: Sends one payload to every address in toaddrs
+ * 				All copies share buf; only the header word, (*hdrs)[i] for toaddrs[i],
+ * 				differs between them. Each copy is dropped and counted on its own,
+ * 				exactly as if it had gone through ENsend.
+ * 				Takes over the caller's reference to buf.
+ *
+ * RETURNS:
+ * number of destinations the message was sent to
+ */
+int EmulNet::ENmulticast(Address *myaddr, vector<Address> &toaddrs, MsgBuffer *buf, vector<int> *hdrs) {
+	int sent = 0;
+
+	for ( unsigned int i = 0; i < toaddrs.size(); i++ ) {
+		if ( ENsend(myaddr, &toaddrs[i], buf->retain(), hdrs ? hdrs->at(i) : 0) > 0 ) {
+			sent++;
+		}
+	}
+	buf->release();
+
+	return sent;
+}
+
+/**
+ * FUNCTION NAME: ENcredits
+ *
+ * DESCRIPTION: Number of messages myaddr can send to toaddr right now without ENsend
+ * 				pushing back. Credits come back as toaddr takes its messages in.
+ * 				Links that leave the process are not metered.
+ */
+int EmulNet::ENcredits(Address *myaddr, Address *toaddr) {
+	int from = *(int *)(myaddr->addr);
+	int to = *(int *)(toaddr->addr);
+	int used = 0;
+
+	if ( par->LINK_CREDITS <= 0 ) {
+		return INT_MAX;
+	}
+	// Only looked up, as other nodes may be sending at the same time
+	unordered_map<long, int>::iterator it = emulnet.inflight.find(linkKey(from, to));
+	if ( it != emulnet.inflight.end() ) {
+		used = it->second;
+	}
+	if ( staging ) {
+		for ( unsigned int i = 0; i < staged[from].size(); i++ ) {
+			if ( *(int *)(staged[from][i].to.addr) == to ) {
+				used++;
+			}
+		}
+	}
+	return par->LINK_CREDITS - used;
+}
+
+/**
+ * FUNCTION NAME: ENdrop
+ *
+ * DESCRIPTION: Drops buf, a message myaddr held back for toaddr and has given up on,
+ * 				and counts it under event. Takes over the caller's reference to buf.
+ */
+void EmulNet::ENdrop(Address *myaddr, Address *toaddr, MsgBuffer *buf, int event) {
+	if ( staging ) {
+		staged_msg sm;
+		sm.to = *toaddr;
+		sm.buf = buf;
+		sm.hdr = 0;
+		sm.event = event;
+		staged[*(int *)(myaddr->addr)].push_back(sm);
+		return;
+	}
+	dropMsg(myaddr, buf, event);
+}
+
+/**
+ * FUNCTION NAME: ENstage
+ *
+ * DESCRIPTION: Starts or stops holding sends back until ENcommit, for stepping nodes in
+ * 				parallel: while staging, a node may send and take in its own messages
+ * 				without touching anything another node uses.
+ */
+void EmulNet::ENstage(bool on) {
+	if ( on ) {
+		// Receivers find the wire already emptied into their mailboxes
+		deliverDue();
+	}
+	staging = on;
+}
+
+/**
+ * FUNCTION NAME: ENcommit
+ *
+ * DESCRIPTION: Gives back the credits of what myaddr took in while staging, then sends
+ * 				what it sent, and drops what it gave up on, in the order it did
+ */
+void EmulNet::ENcommit(Address *myaddr) {
+	int id = *(int *)(myaddr->addr);
+	vector<staged_msg> &out = staged[id];
+
+	for ( unsigned int i = 0; i < freed[id].size(); i++ ) {
+		addInflight(freed[id][i], id, -1);
+	}
+	freed[id].clear();
+	for ( unsigned int i = 0; i < out.size(); i++ ) {
+		if ( SENT_TRAFFIC == out[i].event ) {
+			ENsend(myaddr, &out[i].to, out[i].buf, out[i].hdr);
+		}
+		else {
+			dropMsg(myaddr, out[i].buf, out[i].event);
+		}
+	}
+	out.clear();
+}
+
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: EmulNet send function
+ * 				Copies data into a pooled buffer. Prefer building the message with ENalloc.
+ *
+ * RETURNS:
+ * size
+ */
+int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
+	MsgBuffer *buf = ENalloc(size);
+	memcpy(buf->data(), data, size);
+	return ENsend(myaddr, toaddr, buf);
+}
+
 /**
  * FUNCTION NAME: ENsend
  *
@@ -126,56 +331,448 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return ENsend(myaddr, toaddr, (char *)data.data(), (int)(data.length() * sizeof(char)));
 }
 
 /**
  * FUNCTION NAME: ENrecv
  *
  * DESCRIPTION: EmulNet receive function
+ * 				Hands each message's buffer to enq without copying it; the queue
+ * 				then owns the reference.
  *
  * RETURN:
  * 0
  */
-int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
+int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, MsgBuffer *, int), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
-	int i;
-	char* tmp;
-	int sz;
-	en_msg *emsg;
+	int dst = *(int *)(myaddr->addr);
+	vector<en_msg> *box = emulnet.getMailbox(dst);
+
+	if ( NULL == box ) {
+		return 0;
+	}
+
+	deliverDue();
+
+	// Only this node's own messages are visited. They are drained newest first,
+	// which is the order the old backwards scan over the shared buffer produced,
+	// or oldest first in FIFO mode.
+	if ( par->EN_FIFO ) {
+		for ( unsigned int i = 0; i < box->size(); i++ ) {
+			(*enq)(queue, (*box)[i].buf, (*box)[i].hdr);
+			countMsg(recv_msgs, dst, par->getcurrtime());
+			if ( par->LINK_CREDITS > 0 ) {
+				freeCredit(*(int *)((*box)[i].from.addr), dst);
+			}
+		}
+		__atomic_sub_fetch(&emulnet.currbuffsize, (int)box->size(), __ATOMIC_RELAXED);
+		box->clear();
+	}
+	while ( !box->empty() ) {
+		en_msg em = box->back();
+		box->pop_back();
+		__atomic_sub_fetch(&emulnet.currbuffsize, 1, __ATOMIC_RELAXED);
+
+		(*enq)(queue, em.buf, em.hdr);
+
+		countMsg(recv_msgs, dst, par->getcurrtime());
+		if ( par->LINK_CREDITS > 0 ) {
+			freeCredit(*(int *)(em.from.addr), dst);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: ENpending
+ *
+ * DESCRIPTION: Whether ENrecv would hand myaddr anything in this tick
+ */
+bool EmulNet::ENpending(Address *myaddr) {
+	vector<en_msg> *box = emulnet.getMailbox(*(int *)(myaddr->addr));
+
+	deliverDue();
+	return NULL != box && !box->empty();
+}
+
+/**
+ * FUNCTION NAME: ENpoll
+ *
+ * DESCRIPTION: Waits up to timeoutms for traffic from outside this process.
+ * 				Messages of the emulated network never leave the process, so there is none.
+ *
+ * RETURN:
+ * number of messages picked up
+ */
+int EmulNet::ENpoll(int timeoutms) {
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: rngOf
+ *
+ * DESCRIPTION: Random stream of the sending node id
+ */
+Rng &EmulNet::rngOf(int id) {
+	while ( id >= (int)rngs.size() ) {
+		rngs.push_back(Rng(par->SEED, NET_STREAM + netId, rngs.size()));
+	}
+	return rngs[id];
+}
+
+/**
+ * FUNCTION NAME: sampleLatency
+ *
+ * DESCRIPTION: Draws the number of ticks the next message spends on the wire from rng.
+ * 				A lognormal draw is kept within LATENCY_MIN and LATENCY_MAX, as its tail
+ * 				would otherwise overflow an int.
+ */
+int EmulNet::sampleLatency(Rng &rng) {
+	switch ( par->LATENCY ) {
+		case FIXED_LATENCY:
+			return par->LATENCY_MIN;
+		case UNIFORM_LATENCY:
+			return par->LATENCY_MIN + rng.nextInt(par->LATENCY_MAX - par->LATENCY_MIN + 1);
+		case LOGNORMAL_LATENCY: {
+			// Box-Muller transform of two uniform draws into a standard normal one
+			double u1 = rng.nextDouble();
+			double u2 = rng.nextDouble();
+			double normal = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+			double ticks = exp(par->LATENCY_MU + par->LATENCY_SIGMA * normal);
+			// Written so that a NaN from a draw of u1 = 0 ends up at the lower bound
+			if ( !(ticks >= par->LATENCY_MIN) ) {
+				ticks = par->LATENCY_MIN;
+			}
+			if ( ticks > par->LATENCY_MAX ) {
+				ticks = par->LATENCY_MAX;
+			}
+			return (int)lround(ticks);
+		}
+		default:
+			return 0;
+	}
+}
 
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
+/**
+ * FUNCTION NAME: sendDue
+ *
+ * DESCRIPTION: Draws the tick at which a message of bytes bytes sent now from myaddr to
+ * 				toaddr is delivered: once the sender's NIC has put it out, it spends its
+ * 				latency on the wire, then waits for the receiver's NIC to take it in.
+ */
+int EmulNet::sendDue(Address *myaddr, Address *toaddr, int bytes) {
+	int due = nicDue(emulnet.egress, *(int *)(myaddr->addr), par->NIC_EGRESS_BYTES, bytes, par->getcurrtime());
+	due += sampleLatency(rngOf(*(int *)(myaddr->addr)));
+	due = nicDue(emulnet.ingress, *(int *)(toaddr->addr), par->NIC_INGRESS_BYTES, bytes, due);
+	if ( par->EN_FIFO ) {
+		due = linkDue(*(int *)(myaddr->addr), *(int *)(toaddr->addr), due);
+	}
+	return due;
+}
 
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
+/**
+ * FUNCTION NAME: nicDue
+ *
+ * DESCRIPTION: Runs bytes bytes through a NIC of node moving rate bytes per tick, starting
+ * 				no earlier than tick. The NIC works through messages in the order they are
+ * 				handed to it, and one bigger than rate takes several ticks.
+ * 				Ingress is booked when the message is sent, not when it arrives, so a
+ * 				receiver takes in its messages in the order they were sent.
+ *
+ * RETURNS:
+ * the tick in which the last byte gets through, tick itself when rate is 0 for no limit
+ */
+int EmulNet::nicDue(vector<long> &clock, int node, int rate, int bytes, int tick) {
+	if ( rate <= 0 || node < 0 ) {
+		return tick;
+	}
+	if ( node >= (int)clock.size() ) {
+		clock.resize(node + 1, 0);
+	}
+	long start = max(clock[node], (long)tick * rate);
+	clock[node] = start + bytes;
+	int done = max(tick, (int)((clock[node] - 1) / rate));
+	emulnet.nicdelay += done - tick;
+	return done;
+}
 
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+/**
+ * FUNCTION NAME: deliver
+ *
+ * DESCRIPTION: Takes in a message due at tick due. Messages due by now go straight into the
+ * 				destination's mailbox, the others wait on the wire until their delivery tick.
+ * 				What the wire holds for this tick goes to the mailboxes first, so a message
+ * 				sent with no latency does not get ahead of one sent before it.
+ */
+void EmulNet::deliver(en_msg &em, int due) {
+	deliverDue();
+	if ( due > par->getcurrtime() ) {
+		emulnet.wire.insert(due, em);
+	}
+	else {
+		emulnet.getMailbox(*(int *)(em.to.addr))->push_back(em);
+	}
+	if ( ++emulnet.currbuffsize > emulnet.peakbuffsize ) {
+		emulnet.peakbuffsize = emulnet.currbuffsize;
+	}
+}
 
-			(*enq)(queue, (char *)tmp, sz);
+/**
+ * FUNCTION NAME: linkKey
+ *
+ * DESCRIPTION: Key of the link from from to to in the per-link tables
+ */
+long EmulNet::linkKey(int from, int to) {
+	return (long)from * (par->EN_GPSZ + 1) + to;
+}
 
-			free(emsg);
+/**
+ * FUNCTION NAME: linkDue
+ *
+ * DESCRIPTION: Keeps the delivery ticks of a link from going backwards, so a message
+ * 				never overtakes one sent before it on the same link.
+ * 				The wire and the mailboxes keep messages due in the same tick in the
+ * 				order they were sent.
+ *
+ * RETURNS:
+ * the delivery tick of the message, no earlier than due
+ */
+int EmulNet::linkDue(int from, int to, int due) {
+	int &last = emulnet.linkdue[linkKey(from, to)];
+
+	if ( due < last ) {
+		due = last;
+	}
+	last = due;
+	return due;
+}
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+/**
+ * FUNCTION NAME: addInflight
+ *
+ * DESCRIPTION: Adds change to the messages sent from from to to that to has not taken in yet
+ */
+void EmulNet::addInflight(int from, int to, int change) {
+	long key = linkKey(from, to);
+	int &used = emulnet.inflight[key];
+
+	used += change;
+	if ( 0 == used ) {
+		emulnet.inflight.erase(key);
+	}
+}
+
+/**
+ * FUNCTION NAME: freeCredit
+ *
+ * DESCRIPTION: Gives the link from from to to back the credit of a message to has taken in.
+ * 				While staging, the sender may be looking at the link at the same time, so
+ * 				the credit waits for ENcommit.
+ */
+void EmulNet::freeCredit(int from, int to) {
+	if ( staging ) {
+		freed[to].push_back(from);
+		return;
+	}
+	addInflight(from, to, -1);
+}
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+/**
+ * FUNCTION NAME: deliverDue
+ *
+ * DESCRIPTION: Moves the messages whose delivery tick has come from the wire to their mailboxes,
+ * 				and forgets the FIFO links with nothing left on the wire
+ */
+void EmulNet::deliverDue() {
+	vector<en_msg> due;
 
-			recv_msgs[dst][time]++;
+	if ( par->getcurrtime() <= emulnet.wire.getNow() ) {
+		return;
+	}
+	emulnet.wire.advance(par->getcurrtime(), due);
+	for ( unsigned int i = 0; i < due.size(); i++ ) {
+		emulnet.getMailbox(*(int *)(due[i].to.addr))->push_back(due[i]);
+	}
+	// A delivery tick that has come no longer holds back anything sent from now on
+	for ( unordered_map<long, int>::iterator it = emulnet.linkdue.begin(); it != emulnet.linkdue.end(); ) {
+		if ( it->second <= par->getcurrtime() ) {
+			it = emulnet.linkdue.erase(it);
+		}
+		else {
+			++it;
 		}
 	}
+}
 
+/**
+ * FUNCTION NAME: captureMsg
+ *
+ * DESCRIPTION: Appends a message that is being sent to the capture file, if there is one.
+ * 				The file is opened here rather than in the constructor so that forked
+ * 				workers each write their own.
+ */
+void EmulNet::captureMsg(Address *myaddr, Address *toaddr, MsgBuffer *buf, int hdr, int due) {
+	if ( par->CAPTURE.empty() ) {
+		return;
+	}
+	if ( !capture ) {
+		capture = make_shared<CaptureWriter>(par->filePrefix() + par->CAPTURE + (0 == netId ? ".mp1" : ".mp2"), netId);
+	}
+	capture->record(par->getcurrtime(), due, myaddr, toaddr, hdr, buf->data(), buf->size);
+}
+
+/**
+ * FUNCTION NAME: countTraffic
+ *
+ * DESCRIPTION: Counts buf, sent by myaddr, under event in the tick bucket of now.
+ * 				The message type is the first int of the payload, as in every MP1 and MP2 message.
+ */
+void EmulNet::countTraffic(Address *myaddr, MsgBuffer *buf, int event) {
+	int node = *(int *)(myaddr->addr);
+	int bucket = par->getcurrtime() / max(par->TRAFFIC_BUCKET, 1);
+	int type = buf->size >= (int)sizeof(int) ? *(int *)buf->data() : 0;
+
+	if ( par->TRAFFIC_BUCKET <= 0 || node < 0 || bucket < 0 ) {
+		return;
+	}
+	if ( type < 0 || type > TRAFFIC_MAXTYPE ) {
+		type = TRAFFIC_MAXTYPE;
+	}
+	if ( node >= (int)traffic.size() ) {
+		traffic.resize(node + 1);
+	}
+	vector< vector<traffic_count> > &row = traffic[node];
+	if ( bucket >= (int)row.size() ) {
+		row.resize(bucket + 1);
+	}
+	vector<traffic_count> &cell = row[bucket];
+	if ( (type + 1) * NUM_TRAFFIC_EVENTS > (int)cell.size() ) {
+		traffic_count zero = {0, 0};
+		cell.resize((type + 1) * NUM_TRAFFIC_EVENTS, zero);
+	}
+	cell[type * NUM_TRAFFIC_EVENTS + event].msgs++;
+	cell[type * NUM_TRAFFIC_EVENTS + event].bytes += buf->size;
+}
+
+/**
+ * FUNCTION NAME: dropMsg
+ *
+ * DESCRIPTION: Drops buf, sent by myaddr, for the reason event, and counts it
+ *
+ * RETURNS:
+ * 0, what ENsend returns for a message it did not send
+ */
+int EmulNet::dropMsg(Address *myaddr, MsgBuffer *buf, int event) {
+	switch ( event ) {
+		case BUFFER_FULL_DROP:
+			emulnet.fulldrops++;
+			break;
+		case OVERSIZE_DROP:
+			emulnet.oversizedrops++;
+			break;
+		case NO_CREDIT_DROP:
+			emulnet.creditdrops++;
+			break;
+		case PARTITION_DROP:
+		case LINK_LOSS_DROP:
+		case BANDWIDTH_DROP:
+			emulnet.faultdrops++;
+			break;
+		default:
+			emulnet.randomdrops++;
+	}
+	countTraffic(myaddr, buf, event);
+	buf->release();
 	return 0;
 }
 
+/**
+ * FUNCTION NAME: linkFault
+ *
+ * DESCRIPTION: Checks a message about to go from myaddr to toaddr against the link faults
+ *
+ * RETURNS:
+ * the trafficEVENT dropping it, or SENT_TRAFFIC if it gets through
+ */
+int EmulNet::linkFault(Address *myaddr, Address *toaddr, MsgBuffer *buf) {
+	int from = *(int *)(myaddr->addr);
+
+	switch ( faults.check(from, *(int *)(toaddr->addr), buf->size, par->getcurrtime(), rngOf(from)) ) {
+		case LINK_CUT:
+			return PARTITION_DROP;
+		case LINK_LOSS:
+			return LINK_LOSS_DROP;
+		case LINK_CAPPED:
+			return BANDWIDTH_DROP;
+		default:
+			return SENT_TRAFFIC;
+	}
+}
+
+/**
+ * FUNCTION NAME: writeTraffic
+ *
+ * DESCRIPTION: Writes the traffic counters as CSV, one row per node, bucket, message type
+ * 				and event that saw any message
+ */
+void EmulNet::writeTraffic() {
+	static const char *events[NUM_TRAFFIC_EVENTS] = {"sent", "buffer_full", "oversize", "random_drop", "no_credit", "partition", "link_loss", "bandwidth"};
+
+	if ( par->TRAFFIC_BUCKET <= 0 ) {
+		return;
+	}
+	FILE *file = fopen((par->filePrefix() + "traffic" + (0 == netId ? ".mp1" : ".mp2") + ".csv").c_str(), "w");
+	if ( NULL == file ) {
+		perror("traffic");
+		return;
+	}
+	fprintf(file, "tick,node,type,event,msgs,bytes\n");
+	for ( int node = 0; node < (int)traffic.size(); node++ ) {
+		for ( int bucket = 0; bucket < (int)traffic[node].size(); bucket++ ) {
+			vector<traffic_count> &cell = traffic[node][bucket];
+			for ( int i = 0; i < (int)cell.size(); i++ ) {
+				if ( cell[i].msgs > 0 ) {
+					fprintf(file, "%d,%d,%d,%s,%ld,%ld\n", bucket * par->TRAFFIC_BUCKET, node, i / NUM_TRAFFIC_EVENTS, events[i % NUM_TRAFFIC_EVENTS], cell[i].msgs, cell[i].bytes);
+				}
+			}
+		}
+	}
+	fclose(file);
+}
+
+/**
+ * FUNCTION NAME: countMsg
+ *
+ * DESCRIPTION: Count one message for node at time, growing the counters as needed
+ */
+void EmulNet::countMsg(vector< vector<int> > &counts, int node, int time) {
+	if ( node < 0 || time < 0 ) {
+		return;
+	}
+	if ( node >= (int)counts.size() ) {
+		counts.resize(node + 1);
+	}
+	vector<int> &row = counts[node];
+	if ( time >= (int)row.size() ) {
+		row.resize(time + 1, 0);
+	}
+	row[time]++;
+}
+
+/**
+ * FUNCTION NAME: getCount
+ *
+ * DESCRIPTION: Number of messages counted for node at time
+ */
+int EmulNet::getCount(vector< vector<int> > &counts, int node, int time) {
+	if ( node < 0 || node >= (int)counts.size() || time < 0 || time >= (int)counts[node].size() ) {
+		return 0;
+	}
+	return counts[node][time];
+}
+
 /**
  * FUNCTION NAME: ENcleanup
  *
@@ -186,11 +783,25 @@ int EmulNet::ENcleanup() {
 	int i, j;
 	int sent_total, recv_total;
 
-	FILE* file = fopen("msgcount.log", "w+");
+	FILE* file = fopen((par->filePrefix() + "msgcount.log").c_str(), "w+");
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+	vector<en_msg> onWire;
+	emulnet.wire.clear(onWire);
+	for ( i = 0; i < (int)onWire.size(); i++ ) {
+		onWire[i].buf->release();
+	}
+	for ( i = 0; i < (int)emulnet.mailbox.size(); i++ ) {
+		while ( !emulnet.mailbox[i].empty() ) {
+			emulnet.mailbox[i].back().buf->release();
+			emulnet.mailbox[i].pop_back();
+		}
 	}
+	emulnet.currbuffsize = 0;
+
+	if ( capture ) {
+		capture->flush();
+	}
+	writeTraffic();
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
 		fprintf(file, "node %3d ", i);
@@ -199,22 +810,30 @@ int EmulNet::ENcleanup() {
 
 		for (j = 0; j < par->getcurrtime(); j++) {
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
+			int sent = getCount(sent_msgs, i, j);
+			int recv = getCount(recv_msgs, i, j);
+			sent_total += sent;
+			recv_total += recv;
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", sent, recv);
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, sent, recv);
 			}
 		}
 		fprintf(file, "\n");
 		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
 	}
 
+	long slabBytes = pool->getSlabBytes();
+	for ( i = 0; i < (int)threadPools.size(); i++ ) {
+		slabBytes += threadPools[i]->getSlabBytes();
+	}
+	fprintf(file, "in-flight peak %d  high-water mark %d  dropped when full %d  oversize %d  at random %d  no credit %d  link faults %d  NIC wait ticks %ld  slab bytes %ld\n", emulnet.peakbuffsize, par->EN_BUFFSIZE, emulnet.fulldrops, emulnet.oversizedrops, emulnet.randomdrops, emulnet.creditdrops, emulnet.faultdrops, emulnet.nicdelay, slabBytes);
+
 	fclose(file);
 	return 0;
 }
@@ -7,47 +7,125 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
-#define ENBUFFSIZE 30000
-
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "MsgPool.h"
+#include "TimingWheel.h"
+#include "Capture.h"
+#include "FaultSchedule.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <climits>
+#include <unordered_map>
 
 using namespace std;
 
+/*
+ * Macros
+ */
+// Message types above this one are counted together with it
+#define TRAFFIC_MAXTYPE 31
+// What ENsend returns when the link has no credit left for the message
+#define EN_BACKPRESSURE -1
+
+// What became of a message ENsend was handed
+enum trafficEVENT { SENT_TRAFFIC, BUFFER_FULL_DROP, OVERSIZE_DROP, RANDOM_DROP, NO_CREDIT_DROP, PARTITION_DROP, LINK_LOSS_DROP, BANDWIDTH_DROP, NUM_TRAFFIC_EVENTS };
+
+/**
+ * Struct Name: traffic_count
+ */
+typedef struct traffic_count {
+	long msgs;
+	long bytes;
+}traffic_count;
+
 /**
  * Struct Name: en_msg
  */
 typedef struct en_msg {
-	// Number of bytes after the class
+	// Number of payload bytes
 	int size;
 	// Source node
 	Address from;
 	// Destination node
 	Address to;
+	// Payload, owned by the message until it is handed to the receiver.
+	// Copies of a multicast share one buffer.
+	MsgBuffer *buf;
+	// Per-destination header word, e.g. the replica type of a multicast copy
+	int hdr;
 }en_msg;
 
+/**
+ * Struct Name: staged_msg
+ *
+ * DESCRIPTION: A message sent, or given up on, while nodes are stepped in parallel, held
+ * 				by its sender until ENcommit
+ */
+typedef struct staged_msg {
+	Address to;
+	MsgBuffer *buf;
+	int hdr;
+	// SENT_TRAFFIC to send it, or the trafficEVENT it is dropped for
+	int event;
+}staged_msg;
+
 /**
  * Class Name: EM
  */
 class EM {
 public:
 	int nextid;
+	// Total number of messages in flight, across all mailboxes
 	int currbuffsize;
+	// Highest value currbuffsize has reached
+	int peakbuffsize;
+	// Messages refused because currbuffsize was at the high-water mark
+	int fulldrops;
+	// Messages over MAX_MSG_SIZE
+	int oversizedrops;
+	// Messages lost to MSG_DROP_PROB
+	int randomdrops;
+	// Messages refused because their link had no credit left
+	int creditdrops;
+	// Messages lost to a scheduled link fault
+	int faultdrops;
+	// Ticks messages spent waiting for a NIC, summed over all of them
+	long nicdelay;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
-	EM() {}
+	// Messages waiting for each node, indexed by the integer node id
+	vector< vector<en_msg> > mailbox;
+	// Messages still on the wire, held until their delivery tick
+	TimingWheel<en_msg> wire;
+	// In FIFO mode, the latest delivery tick handed out on each link, by linkKey; a link
+	// is only kept while that tick is still to come
+	unordered_map<long, int> linkdue;
+	// With LINK_CREDITS set, messages sent on each link and not yet received, by linkKey;
+	// a link with none is left out
+	unordered_map<long, int> inflight;
+	// With NIC budgets set, the byte clock of each node's outgoing and incoming side: the
+	// bytes a NIC running flat out since tick 0 would have moved by the time it is free again
+	vector<long> egress;
+	vector<long> ingress;
+	EM(): nextid(0), currbuffsize(0), peakbuffsize(0), fulldrops(0), oversizedrops(0), randomdrops(0), creditdrops(0), faultdrops(0), nicdelay(0), firsteltindex(0) {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
+		this->peakbuffsize = anotherEM.peakbuffsize;
+		this->fulldrops = anotherEM.fulldrops;
+		this->oversizedrops = anotherEM.oversizedrops;
+		this->randomdrops = anotherEM.randomdrops;
+		this->creditdrops = anotherEM.creditdrops;
+		this->faultdrops = anotherEM.faultdrops;
+		this->nicdelay = anotherEM.nicdelay;
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
+		this->mailbox = anotherEM.mailbox;
+		this->wire = anotherEM.wire;
+		this->linkdue = anotherEM.linkdue;
+		this->inflight = anotherEM.inflight;
+		this->egress = anotherEM.egress;
+		this->ingress = anotherEM.ingress;
 		return *this;
 	}
 	int getNextId() {
@@ -68,32 +146,90 @@ public:
 	void setFirstEltIndex(int firsteltindex) {
 		this->firsteltindex = firsteltindex;
 	}
+	vector<en_msg> *getMailbox(int id) {
+		if ( id < 0 ) {
+			return NULL;
+		}
+		if ( id >= (int)mailbox.size() ) {
+			mailbox.resize(id + 1);
+		}
+		return &mailbox[id];
+	}
 	virtual ~EM() {}
 };
 
 /**
  * CLASS NAME: EmulNet
  *
- * DESCRIPTION: This class defines an emulated network
+ * DESCRIPTION: This class defines an emulated network.
+ * 				Other transports derive from it and override ENsend/ENrecv.
  */
 class EmulNet
 { 	
-private:
+protected:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// Per node, per tick message counts. Rows are indexed by node id and only grow
+	// as far as the last tick in which that node sent or received something.
+	vector< vector<int> > sent_msgs;
+	vector< vector<int> > recv_msgs;
+	// With TRAFFIC_BUCKET set, messages and bytes sent or dropped, indexed by node id, then
+	// by tick bucket, then by message type * NUM_TRAFFIC_EVENTS + trafficEVENT
+	vector< vector< vector<traffic_count> > > traffic;
 	int enInited;
 	EM emulnet;
+	// Slabs the message payloads are carved from, shared with copies of this EmulNet
+	shared_ptr<MsgPool> pool;
+	// With THREADS set, the pool of each thread of the ThreadPool but the first
+	vector< shared_ptr<MsgPool> > threadPools;
+	// Whether sends are held in staged, indexed by sender id, until ENcommit
+	bool staging;
+	vector< vector<staged_msg> > staged;
+	// While staging, the senders whose messages each node id has taken in, indexed by
+	// receiver id, to get their credits back at ENcommit
+	vector< vector<int> > freed;
+	// Random stream of each sending node id on this network
+	vector<Rng> rngs;
+	int netId;
+	// Trace of the messages sent, opened by the first one when CAPTURE is set
+	shared_ptr<CaptureWriter> capture;
+	// Link faults of the test case
+	FaultSchedule faults;
+	Rng &rngOf(int id);
+	int sampleLatency(Rng &rng);
+	int sendDue(Address *myaddr, Address *toaddr, int bytes);
+	int nicDue(vector<long> &clock, int node, int rate, int bytes, int tick);
+	void deliver(en_msg &em, int due);
+	long linkKey(int from, int to);
+	int linkDue(int from, int to, int due);
+	void addInflight(int from, int to, int change);
+	void freeCredit(int from, int to);
+	void deliverDue();
+	void captureMsg(Address *myaddr, Address *toaddr, MsgBuffer *buf, int hdr, int due);
+	void countMsg(vector< vector<int> > &counts, int node, int time);
+	void countTraffic(Address *myaddr, MsgBuffer *buf, int event);
+	int dropMsg(Address *myaddr, MsgBuffer *buf, int event);
+	int linkFault(Address *myaddr, Address *toaddr, MsgBuffer *buf);
+	void writeTraffic();
+	int getCount(vector< vector<int> > &counts, int node, int time);
 public:
- 	EmulNet(Params *p);
+ 	EmulNet(Params *p, int netId = 0);
  	EmulNet(EmulNet &anotherEmulNet);
  	EmulNet& operator = (EmulNet &anotherEmulNet);
  	virtual ~EmulNet();
-	void *ENinit(Address *myaddr, short port);
+	virtual void *ENinit(Address *myaddr, short port);
+	MsgBuffer *ENalloc(int size);
+	virtual int ENsend(Address *myaddr, Address *toaddr, MsgBuffer *buf, int hdr = 0);
+	int ENmulticast(Address *myaddr, vector<Address> &toaddrs, MsgBuffer *buf, vector<int> *hdrs = NULL);
+	int ENcredits(Address *myaddr, Address *toaddr);
+	void ENdrop(Address *myaddr, Address *toaddr, MsgBuffer *buf, int event);
+	bool ENpending(Address *myaddr);
+	void ENstage(bool on);
+	void ENcommit(Address *myaddr);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
-	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
-	int ENcleanup();
+	virtual int ENrecv(Address *myaddr, int (* enq)(void *, MsgBuffer *, int), struct timeval *t, int times, void *queue);
+	virtual int ENpoll(int timeoutms);
+	virtual int ENcleanup();
 };
 
 #endif /* _EMULNET_H_ */
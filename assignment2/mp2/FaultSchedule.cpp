@@ -0,0 +1,234 @@
+/**********************************
+ * FILE NAME: FaultSchedule.cpp
+ *
+ * DESCRIPTION: Definition of the FaultSchedule class
+ **********************************/
+
+#include "FaultSchedule.h"
+
+/**
+ * Constructor
+ */
+FaultSchedule::FaultSchedule(): nodes(0), next(0) {}
+
+/**
+ * FUNCTION NAME: init
+ *
+ * DESCRIPTION: Reads the FAULT lines of a test case with nodes nodes, ids 1 to nodes
+ */
+void FaultSchedule::init(vector<string> &lines, int nodes) {
+	char kind[16], from[32], to[32];
+
+	this->nodes = nodes;
+	events.clear();
+	rules.clear();
+	usage.clear();
+	next = 0;
+	for ( unsigned int i = 0; i < lines.size(); i++ ) {
+		fault_event ev;
+		ev.value = 0;
+		int got = sscanf(lines[i].c_str(), "%d %15s %31s %31s %lf", &ev.tick, kind, from, to, &ev.value);
+		string k = got >= 2 ? kind : "";
+
+		if ( "DROP" == k && 5 == got ) {
+			ev.kind = DROP_FAULT;
+		}
+		else if ( "CUT" == k && got >= 4 ) {
+			ev.kind = CUT_FAULT;
+		}
+		else if ( "PARTITION" == k && got >= 4 ) {
+			ev.kind = PARTITION_FAULT;
+		}
+		else if ( "CAP" == k && 5 == got ) {
+			ev.kind = CAP_FAULT;
+		}
+		else if ( "HEAL" == k && got >= 4 ) {
+			ev.kind = HEAL_FAULT;
+		}
+		else {
+			fprintf(stderr, "Bad FAULT line: %s\n", lines[i].c_str());
+			exit(1);
+		}
+		if ( !parseNodes(from, &ev.fromLo, &ev.fromHi) || !parseNodes(to, &ev.toLo, &ev.toHi) ) {
+			fprintf(stderr, "Bad node set in FAULT line: %s\n", lines[i].c_str());
+			exit(1);
+		}
+		events.push_back(ev);
+	}
+	stable_sort(events.begin(), events.end(), [](const fault_event &a, const fault_event &b) {
+		return a.tick < b.tick;
+	});
+}
+
+/**
+ * FUNCTION NAME: parseNodes
+ *
+ * DESCRIPTION: Reads a node set, a single id, a range lo-hi or * for every node
+ *
+ * RETURNS:
+ * false if set is none of these
+ */
+bool FaultSchedule::parseNodes(const char *set, int *lo, int *hi) {
+	if ( 0 == strcmp(set, "*") ) {
+		*lo = 1;
+		*hi = nodes;
+		return true;
+	}
+	int got = sscanf(set, "%d-%d", lo, hi);
+	if ( 1 == got ) {
+		*hi = *lo;
+	}
+	if ( got < 1 ) {
+		return false;
+	}
+	*lo = max(*lo, 1);
+	*hi = min(*hi, nodes);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: apply
+ *
+ * DESCRIPTION: Puts the change of ev in force
+ */
+void FaultSchedule::apply(fault_event &ev) {
+	applyOneWay(ev, ev.fromLo, ev.fromHi, ev.toLo, ev.toHi);
+	if ( PARTITION_FAULT == ev.kind || HEAL_FAULT == ev.kind ) {
+		applyOneWay(ev, ev.toLo, ev.toHi, ev.fromLo, ev.fromHi);
+	}
+}
+
+/**
+ * FUNCTION NAME: fieldsOf
+ *
+ * DESCRIPTION: Bit mask of what a rule of kind sets on its links: 1 the drop probability,
+ * 				2 the cut, 4 the cap
+ */
+int FaultSchedule::fieldsOf(int kind) {
+	switch ( kind ) {
+		case DROP_FAULT:
+			return 1;
+		case CUT_FAULT:
+		case PARTITION_FAULT:
+			return 2;
+		case CAP_FAULT:
+			return 4;
+		default:
+			return 7;
+	}
+}
+
+/**
+ * FUNCTION NAME: covers
+ *
+ * DESCRIPTION: Whether every link of inner is a link of outer
+ */
+bool FaultSchedule::covers(fault_event &outer, fault_event &inner) {
+	return outer.fromLo <= inner.fromLo && inner.fromHi <= outer.fromHi && outer.toLo <= inner.toLo && inner.toHi <= outer.toHi;
+}
+
+/**
+ * FUNCTION NAME: applyOneWay
+ *
+ * DESCRIPTION: Adds the rule of ev for the links from fromLo..fromHi to toLo..toHi, and
+ * 				drops the older rules it leaves nothing of. A HEAL that overlaps no
+ * 				rule left is not kept either.
+ */
+void FaultSchedule::applyOneWay(fault_event &ev, int fromLo, int fromHi, int toLo, int toHi) {
+	fault_event rule = ev;
+	unsigned int kept = 0;
+	bool overlaps = false;
+
+	rule.fromLo = fromLo;
+	rule.fromHi = fromHi;
+	rule.toLo = toLo;
+	rule.toHi = toHi;
+	if ( fromLo > fromHi || toLo > toHi ) {
+		return;
+	}
+	for ( unsigned int i = 0; i < rules.size(); i++ ) {
+		if ( covers(rule, rules[i]) && (fieldsOf(rules[i].kind) & ~fieldsOf(rule.kind)) == 0 ) {
+			continue;
+		}
+		overlaps = overlaps || (rules[i].fromLo <= toHi && fromLo <= rules[i].fromHi && rules[i].toLo <= toHi && toLo <= rules[i].toHi);
+		rules[kept++] = rules[i];
+	}
+	rules.resize(kept);
+	if ( HEAL_FAULT != rule.kind || overlaps ) {
+		rules.push_back(rule);
+	}
+}
+
+/**
+ * FUNCTION NAME: check
+ *
+ * DESCRIPTION: Decides the fate of a message of bytes bytes sent from node from to node to
+ * 				at tick now, after applying the faults due by then. A message that gets
+ * 				through counts against the cap of its link. Draws from rng only on links
+ * 				with a drop probability.
+ *
+ * RETURNS:
+ * linkVERDICT of the message
+ */
+int FaultSchedule::check(int from, int to, int bytes, int now, Rng &rng) {
+	double dropProb = 0;
+	bool cut = false;
+	int capBytes = 0;
+	int decided = 0;
+
+	if ( events.empty() ) {
+		return LINK_OK;
+	}
+	while ( next < events.size() && events[next].tick <= now ) {
+		apply(events[next++]);
+	}
+	if ( from < 1 || from > nodes || to < 1 || to > nodes ) {
+		return LINK_OK;
+	}
+
+	// The newest rule over the link that sets a field decides it; HEAL sets them all back
+	for ( int i = (int)rules.size() - 1; i >= 0 && decided != 7; i-- ) {
+		fault_event &rule = rules[i];
+		if ( from < rule.fromLo || from > rule.fromHi || to < rule.toLo || to > rule.toHi ) {
+			continue;
+		}
+		int fields = fieldsOf(rule.kind) & ~decided;
+		decided |= fields;
+		if ( HEAL_FAULT == rule.kind ) {
+			continue;
+		}
+		if ( fields & 1 ) {
+			dropProb = rule.value;
+		}
+		if ( fields & 2 ) {
+			cut = true;
+		}
+		if ( fields & 4 ) {
+			capBytes = (int)rule.value;
+		}
+	}
+
+	if ( cut ) {
+		return LINK_CUT;
+	}
+	if ( dropProb > 0 && rng.nextDouble() < dropProb ) {
+		return LINK_LOSS;
+	}
+	if ( capBytes > 0 ) {
+		map<long, link_use>::iterator it = usage.find((long)from * (nodes + 1) + to);
+		if ( it == usage.end() ) {
+			link_use fresh = {0, -1};
+			it = usage.insert(make_pair((long)from * (nodes + 1) + to, fresh)).first;
+		}
+		link_use &use = it->second;
+		if ( use.usedTick != now ) {
+			use.usedTick = now;
+			use.usedBytes = 0;
+		}
+		if ( use.usedBytes + bytes > capBytes ) {
+			return LINK_CAPPED;
+		}
+		use.usedBytes += bytes;
+	}
+	return LINK_OK;
+}
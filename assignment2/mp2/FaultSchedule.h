@@ -0,0 +1,82 @@
+/**********************************
+ * FILE NAME: FaultSchedule.h
+ *
+ * DESCRIPTION: Header file of the FaultSchedule class
+ **********************************/
+
+#ifndef FAULTSCHEDULE_H_
+#define FAULTSCHEDULE_H_
+
+#include "stdincludes.h"
+#include "Rng.h"
+
+enum faultKIND { DROP_FAULT, CUT_FAULT, PARTITION_FAULT, CAP_FAULT, HEAL_FAULT };
+// What the link state lets happen to a message
+enum linkVERDICT { LINK_OK, LINK_CUT, LINK_LOSS, LINK_CAPPED };
+
+/**
+ * Struct Name: fault_event
+ *
+ * DESCRIPTION: One FAULT line of the test case: a change to the links from the nodes
+ * 				fromLo..fromHi to the nodes toLo..toHi, made at tick
+ */
+typedef struct fault_event {
+	int tick;
+	int kind;
+	int fromLo, fromHi;
+	int toLo, toHi;
+	// Drop probability of DROP, bytes per tick of CAP
+	double value;
+}fault_event;
+
+/**
+ * Struct Name: link_use
+ *
+ * DESCRIPTION: What a capped link has carried so far in tick usedTick
+ */
+typedef struct link_use {
+	int usedBytes;
+	int usedTick;
+}link_use;
+
+/**
+ * CLASS NAME: FaultSchedule
+ *
+ * DESCRIPTION: Link faults injected at given ticks, read from FAULT lines of the form
+ * 					FAULT: <tick> DROP <from> <to> <probability>
+ * 					FAULT: <tick> CUT <from> <to>
+ * 					FAULT: <tick> PARTITION <from> <to>
+ * 					FAULT: <tick> CAP <from> <to> <bytes per tick>
+ * 					FAULT: <tick> HEAL <from> <to>
+ * 				where <from> and <to> are a node id, a range of them as 3-7, or *.
+ * 				CUT and CAP apply to the links from <from> to <to> only; PARTITION and
+ * 				HEAL to both directions. HEAL puts the links back to normal.
+ * 				The events in force are kept as one-way rules over ranges of nodes, not
+ * 				expanded to the links they cover, and a check looks through them newest
+ * 				first. A rule takes the place of the older ones it fully overrides.
+ */
+class FaultSchedule {
+private:
+	int nodes;
+	vector<fault_event> events;
+	// Next event to apply
+	unsigned int next;
+	// Events applied so far, one way each, oldest first
+	vector<fault_event> rules;
+	// Use of the capped links that have carried something, by from * (nodes + 1) + to
+	map<long, link_use> usage;
+	bool parseNodes(const char *set, int *lo, int *hi);
+	void apply(fault_event &ev);
+	void applyOneWay(fault_event &ev, int fromLo, int fromHi, int toLo, int toHi);
+	static int fieldsOf(int kind);
+	static bool covers(fault_event &outer, fault_event &inner);
+public:
+	FaultSchedule();
+	void init(vector<string> &lines, int nodes);
+	bool empty() {
+		return events.empty();
+	}
+	int check(int from, int to, int bytes, int now, Rng &rng);
+};
+
+#endif /* FAULTSCHEDULE_H_ */
@@ -7,7 +7,10 @@
 #
 # RUN PROCEDURE:
 # $ chmod +x KVStoreGrader.sh
-# $ ./KVStoreGrader.sh
+# $ ./KVStoreGrader.sh [-v] [variant]
+#
+# With a variant, e.g. threads, event, credits, delta, swim or phi, each test
+# runs on testcases/<test>-<variant>.conf where there is one
 #################################################
 
 function contains () {
@@ -22,11 +25,26 @@ function contains () {
     echo 0
 }
 
+function conf () {
+    if [ -n "${variant}" ] && [ -f "./testcases/$1-${variant}.conf" ]; then
+        echo "./testcases/$1-${variant}.conf"
+    else
+        echo "./testcases/$1.conf"
+    fi
+}
+
 ####
 # Main function
 ####
 
 verbose=$(contains "-v" "$@")
+variant=""
+for arg in "$@"
+do
+	if [ "${arg}" != "-v" ]; then
+		variant="${arg}"
+	fi
+done
 
 ###
 # Global variables
@@ -69,7 +87,7 @@ then
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
-    ./Application ./testcases/create.conf > /dev/null 2>&1
+    ./Application $(conf create) > /dev/null 2>&1
 else
 	make clean
 	make
@@ -78,7 +96,7 @@ else
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
-	./Application ./testcases/create.conf
+	./Application $(conf create)
 fi
 
 echo "TEST 1: Create 3 replicas of every key"
@@ -139,7 +157,7 @@ then
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
-    ./Application ./testcases/delete.conf > /dev/null 2>&1
+    ./Application $(conf delete) > /dev/null 2>&1
 else
 	make clean
 	make
@@ -148,7 +166,7 @@ else
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
-	./Application ./testcases/delete.conf
+	./Application $(conf delete)
 fi
 
 echo "TEST 1: Delete 3 replicas of every key"
@@ -237,7 +255,7 @@ then
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
-    ./Application ./testcases/read.conf > /dev/null 2>&1
+    ./Application $(conf read) > /dev/null 2>&1
 else
 	make clean
 	make
@@ -246,7 +264,7 @@ else
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
-	./Application ./testcases/read.conf
+	./Application $(conf read)
 fi
 
 read_operations=`grep -i "${READ_OPERATION}" dbg.log  | cut -d" " -f3 | tr -s ']' ' '  | tr -s '[' ' ' | sort`
@@ -445,7 +463,7 @@ then
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
-    ./Application ./testcases/update.conf > /dev/null 2>&1
+    ./Application $(conf update) > /dev/null 2>&1
 else
 	make clean
 	make
@@ -454,7 +472,7 @@ else
     	echo "COMPILATION ERROR !!!"
     	exit
     fi
-	./Application ./testcases/update.conf
+	./Application $(conf update)
 fi
 
 update_operations=`grep -i "${UPDATE_OPERATION}" dbg.log  | cut -d" " -f3 | tr -s ']' ' '  | tr -s '[' ' ' | sort`
@@ -6,6 +6,11 @@
 
 #include "Log.h"
 
+static FILE *fp;
+static FILE *fp2;
+
+thread_local log_lines *Log::pending = NULL;
+
 /**
  * Constructor
  */
@@ -43,12 +48,11 @@ Log::~Log() {}
  */
 void Log::LOG(Address *addr, const char * str, ...) {
 
-	static FILE *fp;
-	static FILE *fp2;
 	va_list vararglist;
-	static char buffer[30000];
+	static thread_local char buffer[30000];
+	static thread_local char line[30100];
 	static int numwrites;
-	static char stdstring[30];
+	static thread_local char stdstring[30];
 	static char stdstring2[40];
 	static char stdstring3[40]; 
 	static int dbg_opened=0;
@@ -56,7 +60,7 @@ void Log::LOG(Address *addr, const char * str, ...) {
 	if(dbg_opened != 639){
 		numwrites=0;
 
-		stdstring2[0]=0;
+		strcpy(stdstring2, par->filePrefix().c_str());
 
 		strcpy(stdstring3, stdstring2);
 
@@ -73,7 +77,7 @@ void Log::LOG(Address *addr, const char * str, ...) {
 	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
 
 	va_start(vararglist, str);
-	vsprintf(buffer, str, vararglist);
+	vsnprintf(buffer, sizeof(buffer), str, vararglist);
 	va_end(vararglist);
 
 	if (!firstTime) {
@@ -87,6 +91,19 @@ void Log::LOG(Address *addr, const char * str, ...) {
 		firstTime = true;
 	}
 
+	if ( pending ) {
+		// Laid out exactly as below
+		int len = snprintf(line, sizeof(line), "\n %s[%d] ", stdstring, par->getcurrtime());
+		snprintf(line + len, sizeof(line) - len, "%s", buffer);
+		if ( memcmp(buffer, "#STATSLOG#", 10) == 0 ) {
+			pending->stats += line;
+		}
+		else {
+			pending->dbg += line;
+		}
+		return;
+	}
+
 	if(memcmp(buffer, "#STATSLOG#", 10)==0){
 		fprintf(fp2, "\n %s", stdstring);
 		fprintf(fp2, "[%d] ", par->getcurrtime());
@@ -108,13 +125,31 @@ void Log::LOG(Address *addr, const char * str, ...) {
 
 }
 
+/**
+ * FUNCTION NAME: flushLines
+ *
+ * DESCRIPTION: Writes out and clears lines held for a node
+ */
+void Log::flushLines(log_lines &lines) {
+	if ( !lines.dbg.empty() ) {
+		fputs(lines.dbg.c_str(), fp);
+		fflush(fp);
+		lines.dbg.clear();
+	}
+	if ( !lines.stats.empty() ) {
+		fputs(lines.stats.c_str(), fp2);
+		fflush(fp2);
+		lines.stats.clear();
+	}
+}
+
 /**
  * FUNCTION NAME: logNodeAdd
  *
  * DESCRIPTION: To Log a node add
  */
 void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
+	static thread_local char stdstring[100];
 	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
@@ -125,7 +160,7 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  * DESCRIPTION: To log a node remove
  */
 void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
+	static thread_local char stdstring[100];
 	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
     LOG(thisNode, stdstring);
 }
@@ -136,14 +171,12 @@ void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
  * DESCRTION: Call this function after successfully create a key value pair
  */
 void Log::logCreateSuccess(Address * address, bool isCoordinator, int transID, string key, string value){
-	static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: create success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: create success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
 }
 
 /**
@@ -152,14 +185,12 @@ void Log::logCreateSuccess(Address * address, bool isCoordinator, int transID, s
  * DESCRIPTION: Call this function after successfully reading a key
  */
 void Log::logReadSuccess(Address * address, bool isCoordinator, int transID, string key, string value){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: read success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: read success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
 }
 
 /**
@@ -168,14 +199,12 @@ void Log::logReadSuccess(Address * address, bool isCoordinator, int transID, str
  * DESCRIPTION: Call this function after successfully updating a key
  */
 void Log::logUpdateSuccess(Address * address, bool isCoordinator, int transID, string key, string newValue){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: update success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), newValue.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: update success at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), newValue.c_str());
 }
 
 /**
@@ -184,14 +213,12 @@ void Log::logUpdateSuccess(Address * address, bool isCoordinator, int transID, s
  * DESCRIPTION: Call this function after successfully deleting a key
  */
 void Log::logDeleteSuccess(Address * address, bool isCoordinator, int transID, string key){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: delete success at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: delete success at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
 }
 
 /**
@@ -200,14 +227,12 @@ void Log::logDeleteSuccess(Address * address, bool isCoordinator, int transID, s
  * DESCRIPTION: Call this function if CREATE failed
  */
 void Log::logCreateFail(Address * address, bool isCoordinator, int transID, string key, string value){
-	static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: create fail at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: create fail at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), value.c_str());
 }
 
 
@@ -217,14 +242,12 @@ void Log::logCreateFail(Address * address, bool isCoordinator, int transID, stri
  * DESCRIPTION: Call this function if READ failed
  */
 void Log::logReadFail(Address * address, bool isCoordinator, int transID, string key){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: read fail at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: read fail at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
 }
 
 /**
@@ -233,14 +256,12 @@ void Log::logReadFail(Address * address, bool isCoordinator, int transID, string
  * DESCRIPTION: Call this function if UPDATE failed
  */
 void Log::logUpdateFail(Address * address, bool isCoordinator, int transID, string key, string newValue){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: update fail at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), newValue.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: update fail at time %d, transID=%d, key=%s, value=%s", str.c_str(), par->getcurrtime(), transID, key.c_str(), newValue.c_str());
 }
 
 /**
@@ -249,12 +270,10 @@ void Log::logUpdateFail(Address * address, bool isCoordinator, int transID, stri
  * DESCRIPTION: Call this function if DELETE failed
  */
 void Log::logDeleteFail(Address * address, bool isCoordinator, int transID, string key){
-    static char stdstring[100];
 	string str;
 	if (isCoordinator)
 		str = "coordinator";
 	else
 		str = "server";
-	sprintf(stdstring, "%s: delete fail at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
-    LOG(address, stdstring);
+	LOG(address, "%s: delete fail at time %d, transID=%d, key=%s", str.c_str(), par->getcurrtime(), transID, key.c_str());
 }
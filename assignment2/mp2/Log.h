@@ -20,6 +20,17 @@
 #define DBG_LOG "dbg.log"
 #define STATS_LOG "stats.log"
 
+/**
+ * Struct Name: log_lines
+ *
+ * DESCRIPTION: Lines logged by one node while nodes are stepped in parallel,
+ * 				held until they can be written in node order
+ */
+typedef struct log_lines {
+	string dbg;
+	string stats;
+}log_lines;
+
 /**
  * CLASS NAME: Log
  *
@@ -34,7 +45,10 @@ public:
 	Log(const Log &anotherLog);
 	Log& operator = (const Log &anotherLog);
 	virtual ~Log();
+	// Where the lines logged on this thread go instead of the files, if anywhere
+	static thread_local log_lines *pending;
 	void LOG(Address *, const char * str, ...);
+	void flushLines(log_lines &lines);
 	void logNodeAdd(Address *, Address *);
 	void logNodeRemove(Address *, Address *);
 	// success
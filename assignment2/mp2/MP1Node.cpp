@@ -25,6 +25,7 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
 	this->log = log;
 	this->par = params;
 	this->memberNode->addr = *address;
+	this->memberNode->rng.seed(par->SEED, NODE_STREAM, *(int *)(address->addr));
 }
 
 /**
@@ -52,9 +53,9 @@ int MP1Node::recvLoop() {
  *
  * DESCRIPTION: Enqueue the message from Emulnet into the queue
  */
-int MP1Node::enqueueWrapper(void *env, char *buff, int size) {
+int MP1Node::enqueueWrapper(void *env, MsgBuffer *buff, int hdr) {
 	Queue q;
-	return q.enqueue((queue<q_elt> *)env, (void *)buff, size);
+	return q.enqueue((queue<q_elt> *)env, buff, hdr);
 }
 
 /**
@@ -135,7 +136,8 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
     }
     else {
         size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long) + 1;
-        msg = (MessageHdr *) malloc(msgsize * sizeof(char));
+        MsgBuffer *buf = emulNet->ENalloc(msgsize);
+        msg = (MessageHdr *) buf->data();
 
         // create JOINREQ message: format of data is {struct Address myaddr}
         msg->msgType = JOINREQ;
@@ -148,9 +150,7 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 #endif
 
         // send JOINREQ message to introducer member
-        emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, msgsize);
-
-        free(msg);
+        emulNet->ENsend(&memberNode->addr, joinaddr, buf);
     }
 
     return 1;
@@ -162,7 +162,7 @@ void MP1Node::seedMemList(){
     short port;
     memcpy(&id, &memberNode->addr.addr[0], sizeof(int));
     memcpy(&port, &memberNode->addr.addr[4], sizeof(short));
-    this->memberNode->memberList.push_back(MemberListEntry(id, port, memberNode->heartbeat, memberNode->heartbeat));
+    addMember(MemberListEntry(id, port, memberNode->heartbeat, memberNode->heartbeat));
 }
 
 void MP1Node::updateMemList(){
@@ -196,10 +196,27 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
             joinGossipHandler(env, data, size);
             break;
         }
+        case DELTAREQ:
+        case DELTAREP: {
+            deltaHandler(env, data, size);
+            break;
+        }
+        case PING:
+        case PINGREQ:
+        case ACK: {
+            swimHandler(env, data, size);
+            break;
+        }
+        case SYNCREQ:
+        case SYNCREP: {
+            syncHandler(env, data, size);
+            break;
+        }
         default: {
 
         }
     }
+    return true;
 }
 
 bool MP1Node::joinReqHandler(void *env, char *data, int size) {
@@ -210,18 +227,23 @@ bool MP1Node::joinReqHandler(void *env, char *data, int size) {
     short port;
     memcpy(&id, &res->addr.addr[0], sizeof(int));
     memcpy(&port, &res->addr.addr[4], sizeof(short));
-    this->memberNode->memberList.push_back(MemberListEntry(id, port, res->ts, memberNode->heartbeat));
+    addMember(MemberListEntry(id, port, res->ts, memberNode->heartbeat));
     ++this->memberNode->nnb;
 
     log->logNodeAdd(&memberNode->addr, &res->addr);
+    // with SWIM the rest of the group hears of the new member from the introducer
+    if (SWIM_GOSSIP == par->GOSSIP) {
+        spread(memberNode->memberList.back(), ALIVE);
+    }
 
     // send a response message with current membership table.
     size_t msgsize = sizeof(MessageHdr) + sizeof(int) + (sizeof(MemberListEntry)*memberNode->memberList.size()) + 1;
-    JoinRepMsg* msg = (JoinRepMsg*) malloc(msgsize * sizeof(char));
+    MsgBuffer *buf = emulNet->ENalloc(msgsize);
+    JoinRepMsg* msg = (JoinRepMsg*) buf->data();
     msg->msg.msgType = JOINREP;
     msg->len = this->memberNode->nnb;
     memcpy((char *)(msg+1), memberNode->memberList.data(), (sizeof(MemberListEntry)*memberNode->memberList.size()));
-    emulNet->ENsend(&memberNode->addr, &res->addr, (char *)msg, msgsize);
+    emulNet->ENsend(&memberNode->addr, &res->addr, buf);
 
     return true;
 }
@@ -243,25 +265,59 @@ bool MP1Node::joinGossipHandler(void *env, char *data, int size) {
     return true;
 }
 
-void MP1Node::updateNeighborList(MemberListEntry* mem, int n) {
+/**
+ * FUNCTION NAME: deltaHandler
+ *
+ * DESCRIPTION: Merges the entries of a DELTA gossip message. A request is answered with
+ * 				what changed here since the sender was last sent this table, or with all of
+ * 				the live entries if the digests show the two tables disagree on who is live.
+ * 				Nothing is sent back when there is nothing to tell. A reply whose digest
+ * 				still disagrees has the next request to its sender carry the whole table.
+ */
+bool MP1Node::deltaHandler(void *env, char *data, int size) {
+    DeltaMsg* res = (DeltaMsg*)(data);
+    MemberListEntry* mem = (MemberListEntry*)(res + 1);
+    int peer = *(int *)(&res->from.addr);
+    updateNeighborList(mem, res->len, peer);
+
+    int count;
+    unsigned long hash;
+    digest(&count, &hash);
+    bool agree = count == res->count && hash == res->hash;
+
+    if (DELTAREQ == res->msg.msgType) {
+        sendDelta(&res->from, !agree, DELTAREP);
+    }
+    else if (!agree) {
+        if (peer >= 0 && peer < (int)sentVersion.size()) {
+            sentVersion[peer] = 0;
+        }
+    }
+    return true;
+}
+
+void MP1Node::updateNeighborList(MemberListEntry* mem, int n, int from) {
     vector<MemberListEntry> newList;
 
     // update my own list and timestamps
     for(int i=0; i<n; ++i) {
-        bool found = false;
-        for(int j=0; j<memberNode->memberList.size(); ++j) {
-            if(memberNode->memberList[j].id == mem[i].id) {
-                // found member, update it if it has higher heartbeat
-                if(mem[i].heartbeat > memberNode->memberList[j].heartbeat) {
-                    memberNode->memberList[j].settimestamp(memberNode->heartbeat);
-                    memberNode->memberList[j].setheartbeat(mem[i].heartbeat);
+        int j = findMember(mem[i].id);
+        if (j >= 0) {
+            // found member, update it if it has higher heartbeat
+            if(mem[i].heartbeat > memberNode->memberList[j].heartbeat) {
+                recordArrival(mem[i].id, memberNode->heartbeat - memberNode->memberList[j].timestamp);
+                memberNode->memberList[j].settimestamp(memberNode->heartbeat);
+                memberNode->memberList[j].setheartbeat(mem[i].heartbeat);
+                markChanged(mem[i].id, from);
+                if (isFresh(memberNode->memberList[j])) {
+                    syncLive(j);
+                } else {
+                    enterLive(j);
                 }
-                found = true;
-                break;
+                watchMember(j);
             }
         }
-
-        if (!found) {
+        else {
             MemberListEntry entry = mem[i];
             entry.settimestamp(memberNode->heartbeat);
             newList.push_back(entry);
@@ -269,7 +325,7 @@ void MP1Node::updateNeighborList(MemberListEntry* mem, int n) {
     }
 
     for (int i = 0; i < newList.size(); ++i) {
-        memberNode->memberList.push_back(newList[i]);
+        addMember(newList[i], from);
         memberNode->nnb++;
 
         Address entryAddr;
@@ -280,6 +336,255 @@ void MP1Node::updateNeighborList(MemberListEntry* mem, int n) {
     }
 }
 
+/**
+ * FUNCTION NAME: findMember
+ *
+ * DESCRIPTION: Slot of id in the membership list, or -1 if it is not in it. Node ids are
+ * 				small and dense, so memberSlot is indexed by id directly.
+ */
+int MP1Node::findMember(int id) {
+    vector<int> &slot = memberNode->memberSlot;
+    return id >= 0 && id < (int)slot.size() ? slot[id] : -1;
+}
+
+/**
+ * FUNCTION NAME: addMember
+ *
+ * DESCRIPTION: Appends entry to the membership list. An id already in the list keeps
+ * 				pointing at its first entry, as a scan of the list would find that one.
+ */
+void MP1Node::addMember(const MemberListEntry &entry, int from) {
+    vector<int> &slot = memberNode->memberSlot;
+
+    memberNode->memberList.push_back(entry);
+    memberNode->listVersion++;
+    if (entry.id < 0) {
+        return;
+    }
+    markChanged(entry.id, from);
+    if (entry.id >= (int)slot.size()) {
+        slot.resize(max(entry.id + 1, par->EN_GPSZ + 1), -1);
+    }
+    if (slot[entry.id] < 0) {
+        slot[entry.id] = memberNode->memberList.size() - 1;
+        enterLive(slot[entry.id]);
+        watchMember(slot[entry.id]);
+    }
+}
+
+/**
+ * FUNCTION NAME: indexMembers
+ *
+ * DESCRIPTION: Rebuilds memberSlot after entries were taken out of the membership list
+ */
+void MP1Node::indexMembers() {
+    vector<MemberListEntry> &list = memberNode->memberList;
+    vector<int> &slot = memberNode->memberSlot;
+
+    fill(slot.begin(), slot.end(), -1);
+    for (int i = (int)list.size() - 1; i >= 0; --i) {
+        if (list[i].id >= 0 && list[i].id < (int)slot.size()) {
+            slot[list[i].id] = i;
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: markChanged
+ *
+ * DESCRIPTION: Records that the entry of id changed on news from peer from, -1 for none,
+ * 				so DELTA gossip sends it to every other peer on the next exchange
+ */
+void MP1Node::markChanged(int id, int from) {
+    if (id >= (int)changedAt.size()) {
+        changedAt.resize(max(id + 1, par->EN_GPSZ + 1), 0);
+        changedBy.resize(changedAt.size(), -1);
+    }
+    changedAt[id] = ++tableVersion;
+    changedBy[id] = from;
+}
+
+/**
+ * FUNCTION NAME: isFresh
+ *
+ * DESCRIPTION: Whether the member of entry is not taken as failed, which is what gets it
+ * 				gossiped
+ */
+bool MP1Node::isFresh(MemberListEntry &entry) {
+    return entry.id >= 0 && entry.id < (int)liveSlot.size() && liveSlot[entry.id] >= 0;
+}
+
+/**
+ * FUNCTION NAME: failDelay
+ *
+ * DESCRIPTION: Ticks without a new heartbeat after which the member of entry is taken as
+ * 				failed. The FIXED detector takes it as failed after FAIL_TIMEOUT of them. The
+ * 				PHI detector does once phi goes beyond PHI_THRESHOLD, falling back on
+ * 				FAIL_TIMEOUT until it has seen PHISAMPLES heartbeat intervals. Phi only
+ * 				grows with the silence, so the first silence beyond it is searched for.
+ */
+long MP1Node::failDelay(MemberListEntry &entry) {
+    if (PHI_DETECTOR != par->DETECTOR || entry.id < 0 || entry.id >= (int)arrivals.size() || arrivals[entry.id] < PHISAMPLES) {
+        return max(par->FAIL_TIMEOUT + 1, 1);
+    }
+    long lo = 0, hi = 1;
+    while (phi(entry.id, hi) <= par->PHI_THRESHOLD) {
+        lo = hi;
+        hi *= 2;
+    }
+    while (hi - lo > 1) {
+        long mid = lo + (hi - lo) / 2;
+        if (phi(entry.id, mid) > par->PHI_THRESHOLD) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+/**
+ * FUNCTION NAME: recordArrival
+ *
+ * DESCRIPTION: Adds interval, the ticks between the last two heartbeats of id seen here,
+ * 				to the statistics of the PHI detector. Up to PHI_WINDOW intervals they are
+ * 				the plain mean and variance; past it each new interval gets weight
+ * 				1/PHI_WINDOW, so they follow changes in the network with O(1) memory per
+ * 				member instead of a window of intervals.
+ */
+void MP1Node::recordArrival(int id, long interval) {
+    if (PHI_DETECTOR != par->DETECTOR || id < 0) {
+        return;
+    }
+    if (id >= (int)arrivals.size()) {
+        arrivals.resize(max(id + 1, par->EN_GPSZ + 1), 0);
+        arrivalMean.resize(arrivals.size(), 0);
+        arrivalVar.resize(arrivals.size(), 0);
+    }
+    int n = min(++arrivals[id], par->PHI_WINDOW);
+    double delta = interval - arrivalMean[id];
+    arrivalMean[id] += delta / n;
+    arrivalVar[id] += (delta * (interval - arrivalMean[id]) - arrivalVar[id]) / n;
+}
+
+/**
+ * FUNCTION NAME: phi
+ *
+ * DESCRIPTION: Suspicion that id failed after silent ticks without a new heartbeat:
+ * 				-log10 of the chance that a heartbeat comes even later than that, with the
+ * 				intervals taken as normally distributed. Phi 8 is a chance of 1e-8 that the
+ * 				member is still alive. As the intervals are measured at this node, the
+ * 				time gossip takes to cross a larger group is part of them.
+ */
+double MP1Node::phi(int id, long silent) {
+    double std = max(sqrt(arrivalVar[id]), par->PHI_MIN_STD);
+    double later = 0.5 * erfc((silent - arrivalMean[id]) / (std * sqrt(2.0)));
+    return -log10(later);
+}
+
+/**
+ * FUNCTION NAME: digest
+ *
+ * DESCRIPTION: Digest of the fresh entries of the membership table: their number and a
+ * 				hash of their ids that does not depend on their order
+ */
+void MP1Node::digest(int *count, unsigned long *hash) {
+    *count = live.size();
+    *hash = liveHash;
+}
+
+/**
+ * FUNCTION NAME: idHash
+ *
+ * DESCRIPTION: Part of id in the hash of the digest
+ */
+static unsigned long idHash(int id) {
+    uint64_t z = (uint64_t)id * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * FUNCTION NAME: gossipDelta
+ *
+ * DESCRIPTION: One round of DELTA gossip: sends the next of this node's partners what
+ * 				changed since it was last sent the table, along with a digest of the live
+ * 				entries. Partners stay the same from round to round, so a delta only holds
+ * 				the changes of the last few rounds; the partners that stop being live are
+ * 				replaced, and every GOSSIP_ROTATE ticks one is traded for a random member,
+ * 				so that those of the first nodes to join do not stay among themselves.
+ */
+void MP1Node::gossipDelta(vector<MemberListEntry> &fresh) {
+    for (vector<int>::iterator it = partners.begin(); it != partners.end(); /* no increment */) {
+        int slot = findMember(*it);
+        if (slot < 0 || !isFresh(memberNode->memberList[slot])) {
+            it = partners.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (par->GOSSIP_ROTATE > 0 && !partners.empty() && 0 == memberNode->heartbeat % par->GOSSIP_ROTATE) {
+        partners.erase(partners.begin() + memberNode->rng.nextInt(partners.size()));
+    }
+    // fresh[0] is this node; ids may repeat, so the draws are bounded
+    for (unsigned int tries = 0; tries < fresh.size() && (int)partners.size() < par->GOSSIP_FANOUT && fresh.size() > 1; ++tries) {
+        int id = fresh[memberNode->rng.nextInt(fresh.size() - 1) + 1].id;
+        if (id != fresh[0].id && find(partners.begin(), partners.end(), id) == partners.end()) {
+            partners.push_back(id);
+        }
+    }
+    if (partners.empty()) {
+        return;
+    }
+
+    MemberListEntry &peer = memberNode->memberList[findMember(partners[nextPartner++ % partners.size()])];
+    Address to;
+    to.init();
+    *(int *)(&to.addr) = peer.id;
+    *(short *)(&to.addr[4]) = peer.port;
+    sendDelta(&to, false, DELTAREQ);
+}
+
+/**
+ * FUNCTION NAME: sendDelta
+ *
+ * DESCRIPTION: Sends to the fresh entries that changed since to was last sent the table,
+ * 				other than on news from to itself, or all of them, with the digest of the
+ * 				table. An empty reply is not sent.
+ */
+void MP1Node::sendDelta(Address *to, bool all, enum MsgTypes type) {
+    int peer = *(int *)(&to->addr);
+    vector<MemberListEntry> delta;
+
+    if (peer < 0) {
+        return;
+    }
+    if (peer >= (int)sentVersion.size()) {
+        sentVersion.resize(max(peer + 1, par->EN_GPSZ + 1), 0);
+    }
+    for (unsigned int i = 0; i < live.size(); ++i) {
+        MemberListEntry &entry = live[i];
+        int id = entry.id;
+        if (all || id < 0 || id >= (int)changedAt.size() || (changedAt[id] > sentVersion[peer] && changedBy[id] != peer)) {
+            delta.push_back(entry);
+        }
+    }
+    if (DELTAREP == type && delta.empty()) {
+        return;
+    }
+    sentVersion[peer] = tableVersion;
+
+    size_t msgsize = sizeof(DeltaMsg) + (sizeof(MemberListEntry)*delta.size()) + 1;
+    MsgBuffer *buf = emulNet->ENalloc(msgsize);
+    DeltaMsg* msg = (DeltaMsg*) buf->data();
+    msg->msg.msgType = type;
+    msg->len = delta.size();
+    msg->from = memberNode->addr;
+    digest(&msg->count, &msg->hash);
+    memcpy((char *)(msg+1), delta.data(), (sizeof(MemberListEntry)*delta.size()));
+    emulNet->ENsend(&memberNode->addr, to, buf);
+}
+
 /**
  * FUNCTION NAME: finishUpThisNode
  *
@@ -289,6 +594,7 @@ int MP1Node::finishUpThisNode(){
    /*
     * Your code goes here
     */
+    return 0;
 }
 
 /**
@@ -321,15 +627,13 @@ void MP1Node::nodeLoop() {
  * DESCRIPTION: Check messages in the queue and call the respective message handler
  */
 void MP1Node::checkMessages() {
-    void *ptr;
-    int size;
-
     // Pop waiting messages from memberNode's mp1q
     while ( !memberNode->mp1q.empty() ) {
-    	ptr = memberNode->mp1q.front().elt;
-    	size = memberNode->mp1q.front().size;
+    	q_elt elt = memberNode->mp1q.front();
     	memberNode->mp1q.pop();
-    	recvCallBack((void *)memberNode, (char *)ptr, size);
+    	recvCallBack((void *)memberNode, (char *)elt.elt, elt.size);
+    	// done with the message, hand its buffer back to the pool
+    	elt.buf->release();
     }
     return;
 }
@@ -352,17 +656,39 @@ void MP1Node::nodeLoopOps() {
 //    }
 //    cout << endl;
 
+    // SWIM probes members instead of timing out their heartbeats, and keeps this
+    // node's incarnation where its heartbeat would be
+    if (SWIM_GOSSIP == par->GOSSIP) {
+        swimTick();
+        return;
+    }
+
 	// set my own heartbeat in message.
+    // With DELTA gossip a new one is only announced every GOSSIP_PERIOD ticks.
+    long announced = memberNode->heartbeat;
+    if (DELTA_GOSSIP == par->GOSSIP) {
+        announced -= announced % par->GOSSIP_PERIOD;
+    }
     memberNode->memberList[0].settimestamp(memberNode->heartbeat);
-    memberNode->memberList[0].setheartbeat(memberNode->heartbeat);
+    if (announced != memberNode->memberList[0].heartbeat) {
+        memberNode->memberList[0].setheartbeat(announced);
+        markChanged(memberNode->memberList[0].id);
+    }
+    syncLive(0);
 
     // check any pre-fail members and remove them (for now)
-    vector<MemberListEntry> gList = removePreFailMembers();
+    expireMembers();
+    vector<MemberListEntry> &gList = live;
+
+    if (DELTA_GOSSIP == par->GOSSIP) {
+        gossipDelta(gList);
+        return;
+    }
 
     // pick a node at random to send out to.
     int n = 0;
     if(gList.size() > 1) {
-        n = ((rand() % (gList.size() - 1)) + 1);
+        n = memberNode->rng.nextInt(gList.size() - 1) + 1;
     }
 
     Address sendAddr;
@@ -377,39 +703,522 @@ void MP1Node::nodeLoopOps() {
 
     // send it out to other nodes.
     size_t msgsize = sizeof(MessageHdr) + sizeof(int) + (sizeof(MemberListEntry)*gList.size()) + 1;
-    GossipMsg* msg = (GossipMsg*) malloc(msgsize * sizeof(char));
+    MsgBuffer *buf = emulNet->ENalloc(msgsize);
+    GossipMsg* msg = (GossipMsg*) buf->data();
     msg->msg.msgType = GOSSIP;
     msg->len = gList.size();
     memcpy((char *)(msg+1), gList.data(), (sizeof(MemberListEntry)*gList.size()));
-    emulNet->ENsend(&memberNode->addr, &sendAddr, (char *)msg, msgsize);
+    emulNet->ENsend(&memberNode->addr, &sendAddr, buf);
     return;
 }
 
-vector<MemberListEntry> MP1Node::removePreFailMembers() {
-    vector<MemberListEntry> res;
-
-    // Find the filtered list, if they've not responded in TFAIL seconds
-    for (vector<MemberListEntry>::iterator it = memberNode->memberList.begin(); it != memberNode->memberList.end(); /* no increment */) {
-        if(memberNode->heartbeat - it->timestamp > TREMOVE) {
-//            cout << "ENTERED;" << it->timestamp << ";" << memberNode->heartbeat << endl;
+/**
+ * FUNCTION NAME: expireMembers
+ *
+ * DESCRIPTION: Takes the members due to be taken as failed this tick out of the live view,
+ * 				so they are no longer gossiped, and removes those that have been failed for
+ * 				REMOVE_TIMEOUT - FAIL_TIMEOUT more ticks. Only the timers due this tick are
+ * 				looked at, so the cost follows the churn rather than the size of the group.
+ * 				A member that had a new heartbeat since its timer was set gets it set again,
+ * 				so a heartbeat only costs a timer when the last one ran out.
+ * 				Removals are logged in membership list order, as a scan of it would.
+ */
+void MP1Node::expireMembers() {
+    vector<MemberListEntry> &list = memberNode->memberList;
+    vector<MemberTimer> due;
+    vector<int> doomed;
+    long now = memberNode->heartbeat;
+    long grace = par->REMOVE_TIMEOUT - par->FAIL_TIMEOUT;
+
+    expiry.advance(now, due);
+    for (unsigned int i = 0; i < due.size(); ++i) {
+        int id = due[i].id;
+        int slot = findMember(id);
+        if (slot <= 0 || due[i].due != timerDue[id]) {
+            continue;
+        }
+        timerDue[id] = -1;
+        long failAt = list[slot].timestamp + failDelay(list[slot]);
+        if (isFresh(list[slot]) && failAt > now) {
+            setTimer(id, failAt);
+        } else if (isFresh(list[slot]) && grace > 0) {
+            // mark as pre-fail, and stop sending it out.
+            leaveLive(id);
+            setTimer(id, failAt + grace);
+        } else {
+            leaveLive(id);
+            doomed.push_back(slot);
+        }
+    }
+    if (doomed.empty()) {
+        return;
+    }
 
-            Address remAddr;
-            memset(&remAddr, 0, sizeof(Address));
-            *(int *)(&remAddr.addr) = it->id;
-            *(short *)(&remAddr.addr[4]) = it->port;
+    sort(doomed.begin(), doomed.end());
+    unsigned int kept = 0, next = 0;
+    for (unsigned int i = 0; i < list.size(); ++i) {
+        if (next < doomed.size() && doomed[next] == (int)i) {
+            Address remAddr = memberAddress(list[i]);
             log->logNodeRemove(&memberNode->addr, &remAddr);
-
             memberNode->nnb--;
-            it = memberNode->memberList.erase(it);
-        } else if(memberNode->heartbeat - it->timestamp > TFAIL) {
-                // mark as pre-fail in set, and stop sending it out.
-            ++it;
+            memberNode->listVersion++;
+            ++next;
         } else {
-            res.push_back(*it);
-            ++it;
+            list[kept++] = list[i];
         }
     }
-    return res;
+    list.resize(kept);
+    // The slots of the entries behind a removed one have moved up
+    indexMembers();
+}
+
+/**
+ * FUNCTION NAME: watchMember
+ *
+ * DESCRIPTION: Makes sure the entry at slot of the membership list is looked at by the
+ * 				time it is taken as failed, after its last heartbeat. This node's own entry
+ * 				and SWIM members are never timed out.
+ */
+void MP1Node::watchMember(int slot) {
+    MemberListEntry &entry = memberNode->memberList[slot];
+    if (0 == slot || SWIM_GOSSIP == par->GOSSIP || entry.id < 0) {
+        return;
+    }
+    setTimer(entry.id, entry.timestamp + failDelay(entry));
+}
+
+/**
+ * FUNCTION NAME: setTimer
+ *
+ * DESCRIPTION: Sets the timer of id for tick due, unless it is already set for earlier.
+ * 				A timer set for later is left in the wheel and ignored when it comes out.
+ */
+void MP1Node::setTimer(int id, long due) {
+    if (id >= (int)timerDue.size()) {
+        timerDue.resize(max(id + 1, par->EN_GPSZ + 1), -1);
+    }
+    if (timerDue[id] >= 0 && timerDue[id] <= due) {
+        return;
+    }
+    MemberTimer timer = { id, (int)due };
+    timerDue[id] = timer.due;
+    expiry.insert(timer.due, timer);
+}
+
+/**
+ * FUNCTION NAME: enterLive
+ *
+ * DESCRIPTION: Puts the entry at slot of the membership list into the live view. The view
+ * 				is in no particular order, except that this node's own entry comes first,
+ * 				so members going in and out of pre-fail cost O(1).
+ */
+void MP1Node::enterLive(int slot) {
+    MemberListEntry &entry = memberNode->memberList[slot];
+
+    if (entry.id < 0 || isFresh(entry)) {
+        return;
+    }
+    if (entry.id >= (int)liveSlot.size()) {
+        liveSlot.resize(max(entry.id + 1, par->EN_GPSZ + 1), -1);
+    }
+    liveSlot[entry.id] = live.size();
+    live.push_back(entry);
+    liveHash += idHash(entry.id);
+}
+
+/**
+ * FUNCTION NAME: leaveLive
+ *
+ * DESCRIPTION: Takes id out of the live view, moving the last entry of the view into its place
+ */
+void MP1Node::leaveLive(int id) {
+    if (id < 0 || id >= (int)liveSlot.size() || liveSlot[id] < 0) {
+        return;
+    }
+    int at = liveSlot[id];
+    live[at] = live.back();
+    liveSlot[live[at].id] = at;
+    live.pop_back();
+    liveSlot[id] = -1;
+    liveHash -= idHash(id);
+}
+
+/**
+ * FUNCTION NAME: syncLive
+ *
+ * DESCRIPTION: Copies the entry at slot of the membership list to the live view, if it
+ * 				is in it
+ */
+void MP1Node::syncLive(int slot) {
+    MemberListEntry &entry = memberNode->memberList[slot];
+    if (isFresh(entry)) {
+        live[liveSlot[entry.id]] = entry;
+    }
+}
+
+/**
+ * FUNCTION NAME: swimHandler
+ *
+ * DESCRIPTION: Applies the updates piggybacked on a SWIM message. A PING is answered with
+ * 				an ACK, the target of a PINGREQ is probed on its origin's behalf, and an ACK
+ * 				either answers this node's own probe or is passed on to the origin of the
+ * 				probe it was relayed for.
+ */
+bool MP1Node::swimHandler(void *env, char *data, int size) {
+    SwimMsg* res = (SwimMsg*)(data);
+    SwimUpdate* updates = (SwimUpdate*)(res + 1);
+    for (int i = 0; i < res->len; ++i) {
+        applyUpdate(updates[i]);
+    }
+
+    switch (res->msg.msgType) {
+        case PING: {
+            sendSwim(&res->from, ACK, &res->target, &res->origin, res->seq);
+            break;
+        }
+        case PINGREQ: {
+            sendSwim(&res->target, PING, &res->target, &res->origin, res->seq);
+            break;
+        }
+        default: {
+            if (0 != memcmp(res->origin.addr, memberNode->addr.addr, sizeof(res->origin.addr))) {
+                sendSwim(&res->origin, ACK, &res->target, &res->origin, res->seq);
+            } else if (*(int *)(&res->target.addr) == probeTarget && res->seq == probeSeq) {
+                probeAcked = true;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: swimTick
+ *
+ * DESCRIPTION: One tick of SWIM. Members suspected for over SWIM_SUSPECT ticks are removed.
+ * 				A probe that has no ack after SWIM_TIMEOUT ticks is handed to SWIM_HELPERS
+ * 				random members, and one that has none by the end of the period gets its
+ * 				target suspected. Every SWIM_PERIOD ticks the next member is probed, and
+ * 				every SWIM_SYNC periods a random member is synced with.
+ */
+void MP1Node::swimTick() {
+    vector<MemberListEntry> &list = memberNode->memberList;
+    long now = memberNode->heartbeat;
+
+    for (unsigned int i = 1; i < list.size(); /* no increment */) {
+        int id = list[i].id;
+        trackMember(id);
+        if (id >= 0 && suspectedAt[id] >= 0 && now - suspectedAt[id] > par->SWIM_SUSPECT) {
+            spread(list[i], DEAD);
+            removeMember(id);
+        } else {
+            ++i;
+        }
+    }
+
+    int slot = probeTarget >= 0 && !probeAcked ? findMember(probeTarget) : -1;
+    if (slot > 0 && now - probeStart >= par->SWIM_PERIOD) {
+        if (suspectedAt[probeTarget] < 0) {
+            suspectedAt[probeTarget] = now;
+            spread(list[slot], SUSPECT);
+        }
+    } else if (slot > 0 && now - probeStart >= par->SWIM_TIMEOUT && !probeRelayed) {
+        vector<int> helpers;
+        probeRelayed = true;
+        // ids may repeat, so the draws are bounded
+        for (unsigned int tries = 0; tries < list.size() && (int)helpers.size() < par->SWIM_HELPERS && list.size() > 2; ++tries) {
+            int helper = memberNode->rng.nextInt(list.size() - 1) + 1;
+            if (list[helper].id != probeTarget && list[helper].id != list[0].id && find(helpers.begin(), helpers.end(), helper) == helpers.end()) {
+                helpers.push_back(helper);
+            }
+        }
+        Address target = memberAddress(list[slot]);
+        for (unsigned int i = 0; i < helpers.size(); ++i) {
+            Address to = memberAddress(list[helpers[i]]);
+            sendSwim(&to, PINGREQ, &target, &memberNode->addr, probeSeq);
+        }
+    }
+
+    if (now - probeStart >= par->SWIM_PERIOD) {
+        startProbe();
+        if (par->SWIM_SYNC > 0 && 0 == ++periods % par->SWIM_SYNC && list.size() > 1) {
+            MemberListEntry &peer = list[memberNode->rng.nextInt(list.size() - 1) + 1];
+            if (peer.id != list[0].id) {
+                Address to = memberAddress(peer);
+                sendSync(&to, SYNCREQ);
+            }
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: startProbe
+ *
+ * DESCRIPTION: Starts a period by pinging the next member. Members are probed round-robin
+ * 				in an order shuffled on every round, so a failed one is probed within two
+ * 				rounds, rather than whenever a random pick comes to it.
+ */
+void MP1Node::startProbe() {
+    vector<MemberListEntry> &list = memberNode->memberList;
+
+    probeStart = memberNode->heartbeat;
+    probeTarget = -1;
+    probeAcked = false;
+    probeRelayed = false;
+    if (probeNext >= probeOrder.size()) {
+        probeOrder.clear();
+        probeNext = 0;
+        for (unsigned int i = 1; i < list.size(); ++i) {
+            if (list[i].id != list[0].id) {
+                probeOrder.push_back(list[i].id);
+            }
+        }
+        for (int i = (int)probeOrder.size() - 1; i > 0; --i) {
+            swap(probeOrder[i], probeOrder[memberNode->rng.nextInt(i + 1)]);
+        }
+    }
+    // members removed since the order was drawn are skipped
+    while (probeNext < probeOrder.size()) {
+        int slot = findMember(probeOrder[probeNext++]);
+        if (slot > 0) {
+            Address to = memberAddress(list[slot]);
+            probeTarget = list[slot].id;
+            sendSwim(&to, PING, &to, &memberNode->addr, ++probeSeq);
+            return;
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: sendSwim
+ *
+ * DESCRIPTION: Sends a SWIM message carrying up to SWIM_PIGGYBACK updates, those sent the
+ * 				fewest times first and the newest of them before the older ones. An update
+ * 				is dropped once it was sent SWIM_RETRANSMIT times per doubling of the group,
+ * 				which gets it to every member with high probability.
+ */
+void MP1Node::sendSwim(Address *to, enum MsgTypes type, Address *target, Address *origin, int seq) {
+    stable_sort(rumors.begin(), rumors.end(), [](const pair<SwimUpdate, int> &a, const pair<SwimUpdate, int> &b) {
+        return a.second < b.second;
+    });
+    int n = min((int)rumors.size(), par->SWIM_PIGGYBACK);
+
+    size_t msgsize = sizeof(SwimMsg) + (sizeof(SwimUpdate)*n) + 1;
+    MsgBuffer *buf = emulNet->ENalloc(msgsize);
+    SwimMsg* msg = (SwimMsg*) buf->data();
+    msg->msg.msgType = type;
+    msg->from = memberNode->addr;
+    msg->target = *target;
+    msg->origin = *origin;
+    msg->seq = seq;
+    msg->len = n;
+    for (int i = 0; i < n; ++i) {
+        memcpy((char *)(msg+1) + sizeof(SwimUpdate)*i, &rumors[i].first, sizeof(SwimUpdate));
+        rumors[i].second++;
+    }
+    emulNet->ENsend(&memberNode->addr, to, buf);
+
+    int limit = par->SWIM_RETRANSMIT * (int)ceil(log2(memberNode->memberList.size() + 1));
+    rumors.erase(remove_if(rumors.begin(), rumors.end(), [limit](const pair<SwimUpdate, int> &rumor) {
+        return rumor.second >= limit;
+    }), rumors.end());
+}
+
+/**
+ * FUNCTION NAME: syncHandler
+ *
+ * DESCRIPTION: Applies the updates of a sync message. A SYNCREQ whose digest disagrees
+ * 				with that of this node's list is answered with the whole list.
+ */
+bool MP1Node::syncHandler(void *env, char *data, int size) {
+    SyncMsg* res = (SyncMsg*)(data);
+    SwimUpdate* updates = (SwimUpdate*)(res + 1);
+    for (int i = 0; i < res->len; ++i) {
+        applyUpdate(updates[i]);
+    }
+
+    int count;
+    unsigned long hash;
+    digest(&count, &hash);
+    if (SYNCREQ == res->msg.msgType && (count != res->count || hash != res->hash)) {
+        sendSync(&res->from, SYNCREP);
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: sendSync
+ *
+ * DESCRIPTION: Sends a SYNCREQ with the digest of this node's list and its own entry, or a
+ * 				SYNCREP with the whole list, over as many messages as it takes to stay under
+ * 				MAX_MSG_SIZE. Members whose rumors ran out before they reached everybody are
+ * 				still heard of this way, by the members that sync and find they miss them.
+ */
+void MP1Node::sendSync(Address *to, enum MsgTypes type) {
+    vector<MemberListEntry> &list = memberNode->memberList;
+    int fit = max((par->MAX_MSG_SIZE - (int)sizeof(MsgBuffer) - (int)sizeof(SyncMsg) - 1) / (int)sizeof(SwimUpdate), 1);
+    int total = SYNCREQ == type ? 1 : (int)list.size();
+
+    for (int first = 0; first < total; first += fit) {
+        int n = min(fit, total - first);
+        size_t msgsize = sizeof(SyncMsg) + (sizeof(SwimUpdate)*n) + 1;
+        MsgBuffer *buf = emulNet->ENalloc(msgsize);
+        SyncMsg* msg = (SyncMsg*) buf->data();
+        msg->msg.msgType = type;
+        msg->from = memberNode->addr;
+        digest(&msg->count, &msg->hash);
+        msg->len = n;
+        for (int i = 0; i < n; ++i) {
+            SwimUpdate update = currentUpdate(list[first + i]);
+            memcpy((char *)(msg+1) + sizeof(SwimUpdate)*i, &update, sizeof(SwimUpdate));
+        }
+        emulNet->ENsend(&memberNode->addr, to, buf);
+    }
+}
+
+/**
+ * FUNCTION NAME: currentUpdate
+ *
+ * DESCRIPTION: The update that tells where this node stands on the member of entry
+ */
+SwimUpdate MP1Node::currentUpdate(MemberListEntry &entry) {
+    SwimUpdate update;
+    update.id = entry.id;
+    update.port = entry.port;
+    update.state = entry.id >= 0 && entry.id < (int)suspectedAt.size() && suspectedAt[entry.id] >= 0 ? SUSPECT : ALIVE;
+    update.incarnation = entry.heartbeat;
+    return update;
+}
+
+/**
+ * FUNCTION NAME: applyUpdate
+ *
+ * DESCRIPTION: Applies a SWIM update and spreads it on if it changed anything. An update
+ * 				about a member wins over what is known of it with a higher incarnation, and
+ * 				with the same one if it is worse news. A member suspected or removed with
+ * 				this node's own incarnation is refuted with a higher one; a removed member
+ * 				only comes back with a higher incarnation than it was removed at. The death
+ * 				of a member not known here is remembered all the same, so an older rumor of
+ * 				it being alive does not bring it back.
+ */
+void MP1Node::applyUpdate(SwimUpdate &update) {
+    vector<MemberListEntry> &list = memberNode->memberList;
+    int slot = findMember(update.id);
+
+    if (update.id < 0) {
+        return;
+    }
+    trackMember(update.id);
+    if (0 == slot) {
+        if (ALIVE != update.state && update.incarnation >= list[0].heartbeat) {
+            list[0].setheartbeat(update.incarnation + 1);
+            syncLive(0);
+            spread(list[0], ALIVE);
+        }
+        return;
+    }
+
+    if (ALIVE == update.state) {
+        if (slot < 0 && update.incarnation > deadAt[update.id]) {
+            MemberListEntry entry(update.id, update.port, update.incarnation, memberNode->heartbeat);
+            addMember(entry);
+            memberNode->nnb++;
+            Address entryAddr = memberAddress(entry);
+            log->logNodeAdd(&memberNode->addr, &entryAddr);
+            spread(entry, ALIVE);
+        } else if (slot > 0 && update.incarnation > list[slot].heartbeat) {
+            list[slot].setheartbeat(update.incarnation);
+            syncLive(slot);
+            suspectedAt[update.id] = -1;
+            spread(list[slot], ALIVE);
+        }
+    } else if (SUSPECT == update.state) {
+        if (slot > 0 && (update.incarnation > list[slot].heartbeat || (update.incarnation == list[slot].heartbeat && suspectedAt[update.id] < 0))) {
+            list[slot].setheartbeat(update.incarnation);
+            syncLive(slot);
+            if (suspectedAt[update.id] < 0) {
+                suspectedAt[update.id] = memberNode->heartbeat;
+            }
+            spread(list[slot], SUSPECT);
+        }
+    } else if (slot > 0 && update.incarnation >= list[slot].heartbeat) {
+        list[slot].setheartbeat(update.incarnation);
+        spread(list[slot], DEAD);
+        removeMember(update.id);
+    } else if (slot < 0 && update.incarnation > deadAt[update.id]) {
+        MemberListEntry entry(update.id, update.port, update.incarnation, memberNode->heartbeat);
+        deadAt[update.id] = update.incarnation;
+        spread(entry, DEAD);
+    }
+}
+
+/**
+ * FUNCTION NAME: spread
+ *
+ * DESCRIPTION: Queues an update of entry to state, at its incarnation, to be piggybacked
+ * 				on the next SWIM messages. It replaces any update about the same member.
+ */
+void MP1Node::spread(MemberListEntry &entry, int state) {
+    SwimUpdate update;
+    update.id = entry.id;
+    update.port = entry.port;
+    update.state = state;
+    update.incarnation = entry.heartbeat;
+
+    for (vector<pair<SwimUpdate, int> >::iterator it = rumors.begin(); it != rumors.end(); ++it) {
+        if (it->first.id == update.id) {
+            rumors.erase(it);
+            break;
+        }
+    }
+    rumors.insert(rumors.begin(), make_pair(update, 0));
+}
+
+/**
+ * FUNCTION NAME: trackMember
+ *
+ * DESCRIPTION: Makes room for id in the SWIM state kept by id
+ */
+void MP1Node::trackMember(int id) {
+    if (id >= (int)suspectedAt.size()) {
+        suspectedAt.resize(max(id + 1, par->EN_GPSZ + 1), -1);
+        deadAt.resize(suspectedAt.size(), -1);
+    }
+}
+
+/**
+ * FUNCTION NAME: removeMember
+ *
+ * DESCRIPTION: Removes id from the membership list, remembering the incarnation it was
+ * 				removed at
+ */
+void MP1Node::removeMember(int id) {
+    vector<MemberListEntry> &list = memberNode->memberList;
+    int slot = findMember(id);
+
+    Address remAddr = memberAddress(list[slot]);
+    log->logNodeRemove(&memberNode->addr, &remAddr);
+    trackMember(id);
+    deadAt[id] = list[slot].heartbeat;
+    suspectedAt[id] = -1;
+    leaveLive(id);
+
+    memberNode->nnb--;
+    list.erase(list.begin() + slot);
+    memberNode->listVersion++;
+    indexMembers();
+}
+
+/**
+ * FUNCTION NAME: memberAddress
+ *
+ * DESCRIPTION: Address of the member of entry
+ */
+Address MP1Node::memberAddress(MemberListEntry &entry) {
+    Address addr;
+    addr.init();
+    *(int *)(&addr.addr) = entry.id;
+    *(short *)(&addr.addr[4]) = entry.port;
+    return addr;
 }
 
 /**
@@ -443,6 +1252,11 @@ Address MP1Node::getJoinAddress() {
  */
 void MP1Node::initMemberListTable(Member *memberNode) {
 	memberNode->memberList.clear();
+	memberNode->memberSlot.clear();
+	memberNode->listVersion++;
+	live.clear();
+	liveSlot.clear();
+	liveHash = 0;
 }
 
 /**
@@ -14,14 +14,9 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "TimingWheel.h"
 #include <set>
 
-/**
- * Macros
- */
-#define TREMOVE 20
-#define TFAIL 5
-
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
  */
@@ -33,9 +28,25 @@ enum MsgTypes{
     JOINREQ,
     JOINREP,
     GOSSIP,
+    DELTAREQ,
+    DELTAREP,
+    PING,
+    PINGREQ,
+    ACK,
+    SYNCREQ,
+    SYNCREP,
     DUMMYLASTMSGTYPE
 };
 
+/**
+ * States of a member in a SWIM update
+ */
+enum SwimStates{
+    ALIVE,
+    SUSPECT,
+    DEAD
+};
+
 /**
  * STRUCT NAME: MessageHdr
  *
@@ -64,6 +75,77 @@ struct GossipMsg {
     // send table.
 };
 
+/**
+ * STRUCT NAME: DeltaMsg
+ *
+ * DESCRIPTION: DELTA gossip: the entries the sender changed since it last sent its table
+ * 				to the receiver, after a digest of the live entries of that table
+ */
+struct DeltaMsg {
+    MessageHdr msg;
+    int len;
+    Address from;
+    int count;
+    unsigned long hash;
+    // send entries.
+};
+
+/**
+ * STRUCT NAME: MemberTimer
+ *
+ * DESCRIPTION: Tick due at which the entry of id is next looked at by expireMembers
+ */
+struct MemberTimer {
+    int id;
+    int due;
+};
+
+/**
+ * STRUCT NAME: SwimUpdate
+ *
+ * DESCRIPTION: A change to the state of a member, piggybacked on SWIM messages.
+ * 				incarnation orders the updates about the same member; only the member
+ * 				itself raises it, to refute a suspicion.
+ */
+struct SwimUpdate {
+    int id;
+    short port;
+    int state;
+    long incarnation;
+};
+
+/**
+ * STRUCT NAME: SwimMsg
+ *
+ * DESCRIPTION: SWIM PING, PINGREQ or ACK. target is the member probed and origin the one
+ * 				whose probe this is, so a helper can pass on an ack without keeping state.
+ */
+struct SwimMsg {
+    MessageHdr msg;
+    Address from;
+    Address target;
+    Address origin;
+    int seq;
+    int len;
+    // send updates.
+};
+
+/**
+ * STRUCT NAME: SyncMsg
+ *
+ * DESCRIPTION: SWIM anti-entropy: a SYNCREQ carries the digest of the sender's membership
+ * 				list and its own entry, a SYNCREP part of the list of a member whose digest
+ * 				disagreed, as updates at their current state.
+ */
+struct SyncMsg {
+    MessageHdr msg;
+    Address from;
+    int count;
+    unsigned long hash;
+    int len;
+    // send updates.
+};
+
 /**
  * CLASS NAME: MP1Node
  *
@@ -78,6 +160,48 @@ private:
 	char NULLADDR[6];
     int id = 0;
     set<int> preFail;
+    // DELTA gossip: bumped whenever an entry of the membership table changes
+    unsigned long tableVersion = 0;
+    // tableVersion of the last change of each id's entry, and the peer it came from, indexed by id
+    vector<unsigned long> changedAt;
+    vector<int> changedBy;
+    // tableVersion each peer was last sent the table at, indexed by id; 0 for never
+    vector<unsigned long> sentVersion;
+    // Peers this node exchanges deltas with, and the one to send to next
+    vector<int> partners;
+    int nextPartner = 0;
+    // SWIM: the member probed in this period, the probe's number, the tick it was sent in,
+    // and whether it was acked or handed to helpers
+    int probeTarget = -1;
+    int probeSeq = 0;
+    long probeStart = 0;
+    bool probeAcked = false;
+    bool probeRelayed = false;
+    // Members in the random order they are probed in, and the next one to probe
+    vector<int> probeOrder;
+    unsigned int probeNext = 0;
+    // Tick each id was suspected in, indexed by id; -1 when it is not
+    vector<long> suspectedAt;
+    // Incarnation each id was removed at, indexed by id; -1 for none
+    vector<long> deadAt;
+    // Updates still to be piggybacked, with the times each was sent so far
+    vector<pair<SwimUpdate, int> > rumors;
+    // SWIM periods started so far
+    long periods = 0;
+    // PHI detector: heartbeat intervals seen of each id, and their mean and variance, indexed by id
+    vector<int> arrivals;
+    vector<double> arrivalMean;
+    vector<double> arrivalVar;
+    // Entries not taken as failed, this node's own first; what gets gossiped
+    vector<MemberListEntry> live;
+    // Slot of each id in live, indexed by id; -1 for ids not in it
+    vector<int> liveSlot;
+    // Hash part of the digest of live, kept up to date as entries come and go
+    unsigned long liveHash = 0;
+    // When the entries are due to stop being gossiped and to be removed; every id has at
+    // most one timer that counts, due at timerDue[id], -1 for none
+    TimingWheel<MemberTimer> expiry;
+    vector<int> timerDue;
 
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
@@ -85,7 +209,7 @@ public:
 		return memberNode;
 	}
 	int recvLoop();
-	static int enqueueWrapper(void *env, char *buff, int size);
+	static int enqueueWrapper(void *env, MsgBuffer *buff, int hdr);
 	void nodeStart(char *servaddrstr, short serverport);
 	int initThisNode(Address *joinaddr);
 	int introduceSelfToGroup(Address *joinAddress);
@@ -106,8 +230,37 @@ public:
 	void initMemberListTable(Member *memberNode);
 	void printAddress(Address *addr);
 
-    void updateNeighborList(MemberListEntry* mem, int n);
-    vector<MemberListEntry> removePreFailMembers();
+    bool deltaHandler(void *env, char *data, int size);
+    void updateNeighborList(MemberListEntry* mem, int n, int from = -1);
+    int findMember(int id);
+    void addMember(const MemberListEntry &entry, int from = -1);
+    void indexMembers();
+    void markChanged(int id, int from = -1);
+    bool isFresh(MemberListEntry &entry);
+    long failDelay(MemberListEntry &entry);
+    void recordArrival(int id, long interval);
+    double phi(int id, long silent);
+    void digest(int *count, unsigned long *hash);
+    void gossipDelta(vector<MemberListEntry> &fresh);
+    void sendDelta(Address *to, bool all, enum MsgTypes type);
+    void expireMembers();
+    void watchMember(int slot);
+    void setTimer(int id, long due);
+    void enterLive(int slot);
+    void leaveLive(int id);
+    void syncLive(int slot);
+    bool swimHandler(void *env, char *data, int size);
+    void swimTick();
+    void startProbe();
+    void sendSwim(Address *to, enum MsgTypes type, Address *target, Address *origin, int seq);
+    bool syncHandler(void *env, char *data, int size);
+    void sendSync(Address *to, enum MsgTypes type);
+    SwimUpdate currentUpdate(MemberListEntry &entry);
+    void applyUpdate(SwimUpdate &update);
+    void spread(MemberListEntry &entry, int state);
+    void trackMember(int id);
+    void removeMember(int id);
+    Address memberAddress(MemberListEntry &entry);
 
 	virtual ~MP1Node();
 };
@@ -15,12 +15,25 @@ MP2Node::MP2Node(Member *memberNode, Params *par, EmulNet * emulNet, Log * log,
 	this->log = log;
 	ht = new HashTable();
 	this->memberNode->addr = *address;
+	this->cpu = 0;
+	this->ringVersion = 0;
+	if ( par->CPU_BUDGET > 0 ) {
+		static const char *names[] = {"CREATE", "READ", "UPDATE", "DELETE", "REPLY", "READREPLY"};
+		serviceCost.assign(STABILIZE + 1, par->SERVICE_COST);
+		for ( int i = CREATE; i <= READREPLY; i++ ) {
+			serviceCost[i] = par->getint((string("SERVICE_COST_") + names[i]).c_str(), par->SERVICE_COST);
+		}
+		serviceCost[STABILIZE] = par->getint("SERVICE_COST_STABILIZE", par->SERVICE_COST);
+	}
 }
 
 /**
  * Destructor
  */
 MP2Node::~MP2Node() {
+	for ( unsigned int i = 0; i < outbox.size(); i++ ) {
+		outbox[i].buf->release();
+	}
 	delete ht;
 	delete memberNode;
 }
@@ -46,6 +59,7 @@ void MP2Node::updateRing() {
 	 */
 
 	curMemList = getMembershipList();
+	ringVersion = memberNode->listVersion;
 
 	/*
 	 * Step 2: Construct the ring
@@ -73,6 +87,29 @@ void MP2Node::updateRing() {
 
 }
 
+/**
+ * FUNCTION NAME: ringDue
+ *
+ * DESCRIPTION: Whether updateRing would do anything in this tick: the ring has not been built
+ * 				yet or the membership list has changed since, a transaction has timed out,
+ * 				or the successors hash to the same spot, which the stabilization protocol
+ * 				takes for a dead secondary every time it looks
+ */
+bool MP2Node::ringDue() {
+	if ( ring.empty() || memberNode->listVersion != ringVersion ) {
+		return true;
+	}
+	if ( hasMyReplicas.size() > 1 && hasMyReplicas[0].getHashCode() == hasMyReplicas[1].getHashCode() ) {
+		return true;
+	}
+	for ( map<int, TransactionRecord>::iterator it = coordinator.begin(); it != coordinator.end(); it++ ) {
+		if ( par->getcurrtime() - it->second.timestamp > TRANSACTION_TIMEOUT ) {
+			return true;
+		}
+	}
+	return false;
+}
+
 vector<Node> MP2Node::updatePredecessors(const vector<Node>& nodeList, int pos) {
 	vector<Node> predecessors;
 	pos += nodeList.size();
@@ -91,7 +128,7 @@ vector<Node> MP2Node::updateSuccessors(const vector<Node>& nodeList, int pos) {
 void MP2Node::reportFailedTransactions() {
 	for (map<int, TransactionRecord>::iterator it = coordinator.begin(); it != coordinator.end(); ) {
 		const TransactionRecord& tr = it->second;
-		if (par->getcurrtime() - tr.timestamp > 25) {
+		if (par->getcurrtime() - tr.timestamp > TRANSACTION_TIMEOUT) {
 			// coordinator fails the transaction.
 			switch(tr.msgType) {
 				case CREATE: {
@@ -155,7 +192,7 @@ vector<Node> MP2Node::getMembershipList() {
 size_t MP2Node::hashFunction(string key) {
 	std::hash<string> hashFunc;
 	size_t ret = hashFunc(key);
-	return ret%RING_SIZE;
+	return ret%par->RING_SIZE;
 }
 
 /**
@@ -168,14 +205,13 @@ size_t MP2Node::hashFunction(string key) {
  * 				3) Sends a message to the replica
  */
 void MP2Node::clientCreate(string key, string value) {
-	vector<Node> nodes;
-
 	const char* keyChars = key.c_str();
 	const char* valueChars = value.c_str();
 
 	// find the right members to send message to; and send.
 	size_t msgsize = sizeof(CreateMsg) + strlen(keyChars) + 1 + strlen(valueChars) + 2;
-	CreateMsg* msg = (CreateMsg*) malloc(msgsize * sizeof(char));
+	MsgBuffer *buf = emulNet->ENalloc(msgsize);
+	CreateMsg* msg = (CreateMsg*) buf->data();
 	msg->msgType = CREATE;
 	msg->gtid = ++g_transID;
 	msg->coordAddr = memberNode->addr;
@@ -191,15 +227,7 @@ void MP2Node::clientCreate(string key, string value) {
 	coordinator[msg->gtid] = TransactionRecord{CREATE, 3, 0, key, value, par->getcurrtime()};
 
 	// find the replicas to send it to:
-	nodes = findNodes(key);
-	msg->replicaType = PRIMARY;
-	emulNet->ENsend(&memberNode->addr, nodes[0].getAddress(), (char *)msg, msgsize);
-
-	msg->replicaType = SECONDARY;
-	emulNet->ENsend(&memberNode->addr, nodes[1].getAddress(), (char *)msg, msgsize);
-
-	msg->replicaType = TERTIARY;
-	emulNet->ENsend(&memberNode->addr, nodes[2].getAddress(), (char *)msg, msgsize);
+	multicastToReplicas(key, buf);
 }
 
 /**
@@ -216,7 +244,8 @@ void MP2Node::clientRead(string key){
 
 	// find the right members to send message to; and send.
 	size_t msgsize = sizeof(ReadMsg) + (strlen(keyChars)) + 2;
-	ReadMsg* msg = (ReadMsg*) malloc(msgsize * sizeof(char));
+	MsgBuffer *buf = emulNet->ENalloc(msgsize);
+	ReadMsg* msg = (ReadMsg*) buf->data();
 	msg->msgType = READ;
 	msg->gtid = ++g_transID;
 	msg->coordAddr = memberNode->addr;
@@ -229,11 +258,7 @@ void MP2Node::clientRead(string key){
 	coordinator[msg->gtid] = TransactionRecord{READ, 3, 0, key, "", par->getcurrtime()};
 
 	// find the replicas to send it to
-	vector<Node> nodes;
-	nodes = findNodes(key);
-	for (int i=0; i<nodes.size(); ++i){
-		emulNet->ENsend(&memberNode->addr, nodes[i].getAddress(), (char *)msg, msgsize);
-	}
+	multicastToReplicas(key, buf);
 }
 
 /**
@@ -246,14 +271,13 @@ void MP2Node::clientRead(string key){
  * 				3) Sends a message to the replica
  */
 void MP2Node::clientUpdate(string key, string value){
-	vector<Node> nodes;
-
 	const char* keyChars = key.c_str();
 	const char* valueChars = value.c_str();
 
 	// find the right members to send message to; and send.
 	size_t msgsize = sizeof(CreateMsg) + strlen(keyChars) + 1 + strlen(valueChars) + 2;
-	CreateMsg* msg = (CreateMsg*) malloc(msgsize * sizeof(char));
+	MsgBuffer *buf = emulNet->ENalloc(msgsize);
+	CreateMsg* msg = (CreateMsg*) buf->data();
 	msg->msgType = UPDATE;
 	msg->gtid = ++g_transID;
 	msg->coordAddr = memberNode->addr;
@@ -269,15 +293,7 @@ void MP2Node::clientUpdate(string key, string value){
 	coordinator[msg->gtid] = TransactionRecord{UPDATE, 3, 0, key, value, par->getcurrtime()};
 
 	// find the replicas to send it to:
-	nodes = findNodes(key);
-	msg->replicaType = PRIMARY;
-	emulNet->ENsend(&memberNode->addr, nodes[0].getAddress(), (char *)msg, msgsize);
-
-	msg->replicaType = SECONDARY;
-	emulNet->ENsend(&memberNode->addr, nodes[1].getAddress(), (char *)msg, msgsize);
-
-	msg->replicaType = TERTIARY;
-	emulNet->ENsend(&memberNode->addr, nodes[2].getAddress(), (char *)msg, msgsize);
+	multicastToReplicas(key, buf);
 }
 
 /**
@@ -297,7 +313,8 @@ void MP2Node::clientDelete(string key){
 
 	// find the right members to send message to; and send.
 	size_t msgsize = sizeof(DeleteMsg) + (strlen(keyChars)) + 2;
-	DeleteMsg* msg = (DeleteMsg*) malloc(msgsize * sizeof(char));
+	MsgBuffer *buf = emulNet->ENalloc(msgsize);
+	DeleteMsg* msg = (DeleteMsg*) buf->data();
 	msg->msgType = DELETE;
 	msg->gtid = ++g_transID;
 	msg->coordAddr = memberNode->addr;
@@ -310,11 +327,7 @@ void MP2Node::clientDelete(string key){
 	coordinator[msg->gtid] = TransactionRecord{DELETE, 3, 0, key, "", par->getcurrtime()};
 
 	// find the replicas to send it to
-	vector<Node> nodes;
-	nodes = findNodes(key);
-	for (int i=0; i<nodes.size(); ++i){
-		emulNet->ENsend(&memberNode->addr, nodes[i].getAddress(), (char *)msg, msgsize);
-	}
+	multicastToReplicas(key, buf);
 }
 
 /**
@@ -406,15 +419,29 @@ void MP2Node::checkMessages() {
 	 * Declare your local variables here
 	 */
 
-	// dequeue all messages and handle them
-	while ( !memberNode->mp2q.empty() ) {
+	// links that got credits back since the last tick take what was held back first
+	flushOutbox();
+
+	size_t depth = memberNode->mp2q.size();
+	if ( depth >= depthHist.size() ) {
+		depthHist.resize(depth + 1, 0);
+	}
+	depthHist[depth]++;
+
+	// Idle CPU is not banked, but running over the budget is paid back in the next ticks
+	if ( par->CPU_BUDGET > 0 ) {
+		cpu = min(cpu + par->CPU_BUDGET, par->CPU_BUDGET);
+	}
+
+	// dequeue the messages the CPU budget allows, or all of them, and handle them
+	while ( !memberNode->mp2q.empty() && (par->CPU_BUDGET <= 0 || cpu > 0) ) {
 		/*
 		 * Pop a message from the queue
 		 */
-		data = (char *)memberNode->mp2q.front().elt;
-		size = memberNode->mp2q.front().size;
+		q_elt elt = memberNode->mp2q.front();
+		data = (char *)elt.elt;
+		size = elt.size;
 		memberNode->mp2q.pop();
-		string message(data, data + size);
 
 		/*
 		 * Handle the message types here
@@ -422,13 +449,16 @@ void MP2Node::checkMessages() {
 
 
 		MessageHdr2* res = (MessageHdr2*)(data);
+		if ( par->CPU_BUDGET > 0 ) {
+			cpu -= costOf(res->msgType);
+		}
 		switch(res->msgType) {
 			case CREATE: {
-				handleCreate(data, size);
+				handleCreate(data, size, (ReplicaType)elt.hdr);
 				break;
 			}
 			case UPDATE: {
-				handleUpdate(data, size);
+				handleUpdate(data, size, (ReplicaType)elt.hdr);
 				break;
 			}
 			case DELETE: {
@@ -456,6 +486,8 @@ void MP2Node::checkMessages() {
 			}
 		}
 
+		// done with the message, hand its buffer back to the pool
+		elt.buf->release();
 	}
 
 	/*
@@ -464,14 +496,36 @@ void MP2Node::checkMessages() {
 	 */
 }
 
-void MP2Node::handleUpdate(char* data, int size) {
+/**
+ * FUNCTION NAME: busy
+ *
+ * DESCRIPTION: Whether checkMessages has anything to do in this tick: messages to handle,
+ * 				sends held back, or CPU to win back from an earlier tick
+ */
+bool MP2Node::busy() {
+	return !memberNode->mp2q.empty() || !outbox.empty() || (par->CPU_BUDGET > 0 && cpu < par->CPU_BUDGET);
+}
+
+/**
+ * FUNCTION NAME: idleTick
+ *
+ * DESCRIPTION: Accounts for a tick in which checkMessages was skipped as the node was not busy
+ */
+void MP2Node::idleTick() {
+	if ( depthHist.empty() ) {
+		depthHist.resize(1, 0);
+	}
+	depthHist[0]++;
+}
+
+void MP2Node::handleUpdate(char* data, int size, ReplicaType replica) {
 	CreateMsg* msg = (CreateMsg*)data;
 	string key = (char*)(msg+1);
 	string val = (char*)(msg+1) + msg->keyLen;
 	int tid = msg->gtid;
 
 	// always primary replica.
-	if(updateKeyValue(key, val, msg->replicaType)){
+	if(updateKeyValue(key, val, replica)){
 		log->logUpdateSuccess(&memberNode->addr, false, msg->gtid, key, val);
 	} else {
 		log->logUpdateFail(&memberNode->addr, false, msg->gtid, key, val);
@@ -480,10 +534,11 @@ void MP2Node::handleUpdate(char* data, int size) {
 
 	// reply with an ACK for the transaction
 	size_t msgsize = sizeof(ReplyMsg) + 1;
-	ReplyMsg* repMsg = (ReplyMsg*) malloc(msgsize * sizeof(char));
+	MsgBuffer *buf = emulNet->ENalloc(msgsize);
+	ReplyMsg* repMsg = (ReplyMsg*) buf->data();
 	repMsg->gtid = msg->gtid;
 	repMsg->msgType = REPLY;
-	emulNet->ENsend(&memberNode->addr, &msg->coordAddr, (char*)repMsg, msgsize);
+	sendOrDefer(&msg->coordAddr, buf);
 }
 
 void MP2Node::handleStabilize(char* data, int size) {
@@ -501,7 +556,8 @@ void MP2Node::handleRead(char* data, int size) {
 	const char* valChars = value.c_str();
 
 	size_t msgsize = sizeof(ReadReplyMsg) + strlen(valChars) + 2;
-	ReadReplyMsg* repMsg = (ReadReplyMsg*) malloc(msgsize * sizeof(char));
+	MsgBuffer *buf = emulNet->ENalloc(msgsize);
+	ReadReplyMsg* repMsg = (ReadReplyMsg*) buf->data();
 	repMsg->gtid = msg->gtid;
 	repMsg->msgType = READREPLY;
 
@@ -517,7 +573,7 @@ void MP2Node::handleRead(char* data, int size) {
 	strcpy(ptr, valChars);
 
 	// reply with an ACK for the transaction
-	emulNet->ENsend(&memberNode->addr, &msg->coordAddr, (char*)repMsg, msgsize);
+	sendOrDefer(&msg->coordAddr, buf);
 }
 
 void MP2Node::handleDelete(char* data, int size) {
@@ -525,7 +581,8 @@ void MP2Node::handleDelete(char* data, int size) {
 	string key = (char*)(msg+1);
 
 	size_t msgsize = sizeof(ReplyMsg) + 1;
-	ReplyMsg* repMsg = (ReplyMsg*) malloc(msgsize * sizeof(char));
+	MsgBuffer *buf = emulNet->ENalloc(msgsize);
+	ReplyMsg* repMsg = (ReplyMsg*) buf->data();
 	repMsg->gtid = msg->gtid;
 	repMsg->msgType = REPLY;
 
@@ -539,27 +596,28 @@ void MP2Node::handleDelete(char* data, int size) {
 	}
 
 	// reply with an ACK for the transaction
-	emulNet->ENsend(&memberNode->addr, &msg->coordAddr, (char*)repMsg, msgsize);
+	sendOrDefer(&msg->coordAddr, buf);
 }
 
-void MP2Node::handleCreate(char* data, int size) {
+void MP2Node::handleCreate(char* data, int size, ReplicaType replica) {
 	CreateMsg* msg = (CreateMsg*)data;
 	string key = (char*)(msg+1);
 	string val = (char*)(msg+1) + msg->keyLen;
 	int tid = msg->gtid;
 
 	// always primary replica.
-	createKeyValue(key, val, msg->replicaType);
+	createKeyValue(key, val, replica);
 
 	// write logs
 	log->logCreateSuccess(&memberNode->addr, false, msg->gtid, key, val);
 
 	// reply with an ACK for the transaction
 	size_t msgsize = sizeof(ReplyMsg) + 1;
-	ReplyMsg* repMsg = (ReplyMsg*) malloc(msgsize * sizeof(char));
+	MsgBuffer *buf = emulNet->ENalloc(msgsize);
+	ReplyMsg* repMsg = (ReplyMsg*) buf->data();
 	repMsg->gtid = msg->gtid;
 	repMsg->msgType = REPLY;
-	emulNet->ENsend(&memberNode->addr, &msg->coordAddr, (char*)repMsg, msgsize);
+	sendOrDefer(&msg->coordAddr, buf);
 }
 
 void MP2Node::handleReadReply(char* data, int size) {
@@ -599,6 +657,7 @@ void MP2Node::handleReadReply(char* data, int size) {
 						log->logReadFail(&memberNode->addr, true, msg->gtid, it->second.key);
 					}
 					coordinator.erase(it);
+					break;
 				}
 			}
 		}
@@ -674,6 +733,104 @@ vector<Node> MP2Node::findNodes(string key) {
 	return addr_vec;
 }
 
+/**
+ * FUNCTION NAME: costOf
+ *
+ * DESCRIPTION: CPU it takes to handle a message of msgType, SERVICE_COST_<TYPE> or SERVICE_COST
+ */
+int MP2Node::costOf(int msgType) {
+	if ( msgType < 0 || msgType >= (int)serviceCost.size() ) {
+		return par->SERVICE_COST;
+	}
+	return serviceCost[msgType];
+}
+
+/**
+ * FUNCTION NAME: multicastToReplicas
+ *
+ * DESCRIPTION: Sends buf to every replica of key in one ENmulticast
+ * 				Each copy carries the ReplicaType of its destination in its header;
+ * 				the payload itself is shared by all of them. A copy whose link has no
+ * 				credit left waits in the outbox without holding up the others.
+ */
+void MP2Node::multicastToReplicas(string key, MsgBuffer *buf) {
+	vector<Node> nodes = findNodes(key);
+	vector<Address> toaddrs;
+	vector<int> hdrs;
+
+	for (int i=0; i<nodes.size(); ++i) {
+		if ( emulNet->ENcredits(&memberNode->addr, nodes[i].getAddress()) > 0 ) {
+			toaddrs.push_back(*nodes[i].getAddress());
+			hdrs.push_back(PRIMARY + i);
+		}
+		else {
+			sendOrDefer(nodes[i].getAddress(), buf->retain(), PRIMARY + i);
+		}
+	}
+	emulNet->ENmulticast(&memberNode->addr, toaddrs, buf, &hdrs);
+}
+
+/**
+ * FUNCTION NAME: sendOrDefer
+ *
+ * DESCRIPTION: Sends buf to to, or holds it in the outbox if the link has no credit left,
+ * 				rather than have EmulNet push it back
+ */
+void MP2Node::sendOrDefer(Address *to, MsgBuffer *buf, int hdr) {
+	if ( emulNet->ENcredits(&memberNode->addr, to) > 0 ) {
+		emulNet->ENsend(&memberNode->addr, to, buf, hdr);
+		return;
+	}
+	DeferredMsg deferred;
+	deferred.to = *to;
+	deferred.buf = buf;
+	deferred.hdr = hdr;
+	deferred.since = par->getcurrtime();
+	outbox.push_back(deferred);
+}
+
+/**
+ * FUNCTION NAME: flushOutbox
+ *
+ * DESCRIPTION: Sends what the outbox holds for links that have credits again.
+ * 				A failed node never takes its messages in to give the credits back, so what
+ * 				waits for one that has left the ring, or for longer than a transaction
+ * 				would, is dropped. The rest keeps its order for the next try.
+ */
+void MP2Node::flushOutbox() {
+	unsigned int kept = 0;
+
+	for ( unsigned int i = 0; i < outbox.size(); i++ ) {
+		if ( emulNet->ENcredits(&memberNode->addr, &outbox[i].to) > 0 ) {
+			emulNet->ENsend(&memberNode->addr, &outbox[i].to, outbox[i].buf, outbox[i].hdr);
+		}
+		else if ( par->getcurrtime() - outbox[i].since > TRANSACTION_TIMEOUT || !inRing(&outbox[i].to) ) {
+			emulNet->ENdrop(&memberNode->addr, &outbox[i].to, outbox[i].buf, NO_CREDIT_DROP);
+		}
+		else {
+			outbox[kept++] = outbox[i];
+		}
+	}
+	outbox.resize(kept);
+}
+
+/**
+ * FUNCTION NAME: inRing
+ *
+ * DESCRIPTION: Whether addr is on the ring as this node last built it
+ */
+bool MP2Node::inRing(Address *addr) {
+	Node node(*addr);
+	vector<Node>::iterator it = lower_bound(ring.begin(), ring.end(), node);
+
+	for ( ; it != ring.end() && it->getHashCode() == node.getHashCode(); it++ ) {
+		if ( *it->getAddress() == *addr ) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * FUNCTION NAME: recvLoop
  *
@@ -693,9 +850,9 @@ bool MP2Node::recvLoop() {
  *
  * DESCRIPTION: Enqueue the message from Emulnet into the queue of MP2Node
  */
-int MP2Node::enqueueWrapper(void *env, char *buff, int size) {
+int MP2Node::enqueueWrapper(void *env, MsgBuffer *buff, int hdr) {
 	Queue q;
-	return q.enqueue((queue<q_elt> *)env, (void *)buff, size);
+	return q.enqueue((queue<q_elt> *)env, buff, hdr);
 }
 /**
  * FUNCTION NAME: stabilizationProtocol
@@ -775,12 +932,14 @@ void MP2Node::replicateKeys(ReplicaType srcType, ReplicaType destType, Node& des
 			continue;
 		}
 
+		string value = readKey(ent.first);
 		const char* keyChars = ent.first.c_str();
-		const char* valueChars = readKey(ent.first).c_str();
+		const char* valueChars = value.c_str();
 
 		// find the right members to send message to; and send.
 		size_t msgsize = sizeof(StabilizeMsg) + strlen(keyChars) + 1 + strlen(valueChars) + 2;
-		StabilizeMsg* msg = (StabilizeMsg*) malloc(msgsize * sizeof(char));
+		MsgBuffer *buf = emulNet->ENalloc(msgsize);
+		StabilizeMsg* msg = (StabilizeMsg*) buf->data();
 		msg->msgType = STABILIZE;
 		msg->keyLen = strlen(keyChars) + 1;
 		msg->valLen = strlen(valueChars) + 1;
@@ -792,7 +951,7 @@ void MP2Node::replicateKeys(ReplicaType srcType, ReplicaType destType, Node& des
 		strcpy(ptr+1, valueChars);
 
 		// find the replicas to send it to:
-		emulNet->ENsend(&memberNode->addr, destination.getAddress(), (char *)msg, msgsize);
+		sendOrDefer(destination.getAddress(), buf);
 	}
 }
 
@@ -22,6 +22,12 @@
 #include <string>
 #include <cassert>
 
+/**
+ * Macros
+ */
+// Ticks a coordinator waits for the replies of a transaction before it fails it
+#define TRANSACTION_TIMEOUT 25
+
 /**
  * CLASS NAME: MP2Node
  *
@@ -37,13 +43,14 @@ enum SpecialMessageType {
 	STABILIZE = 10
 };
 
+// The replica type of a CREATE/UPDATE travels in the per-destination
+// header of the multicast, so all replicas share one payload
 struct CreateMsg {
 	MessageType msgType;
 	int gtid;
 	int keyLen;
 	int valLen;
 	Address coordAddr;
-	ReplicaType replicaType;
 };
 
 struct StabilizeMsg {
@@ -96,6 +103,15 @@ struct TransactionRecord {
 
 };
 
+// A message waiting for its link to get a credit back
+struct DeferredMsg {
+	Address to;
+	MsgBuffer *buf;
+	int hdr;
+	// Tick it was held back in
+	int since;
+};
+
 class MP2Node {
 private:
 	// Vector holding the next two neighbors in the ring who have my replicas
@@ -116,6 +132,16 @@ private:
 	Log * log;
 	// Table holding acks to receive (tid->(num_acks,TTL))
 	map<int, TransactionRecord> coordinator;
+	// Messages held back by flow control, in the order they were sent
+	vector<DeferredMsg> outbox;
+	// With a CPU_BUDGET, the cost of handling each message type
+	vector<int> serviceCost;
+	// CPU left in this tick; negative when the last message handled ran over
+	int cpu;
+	// Number of ticks checkMessages found the queue at each depth
+	vector<long> depthHist;
+	// listVersion of the membership list the ring was last built from
+	unsigned long ringVersion;
 
 public:
 	MP2Node(Member *memberNode, Params *par, EmulNet *emulNet, Log *log, Address *addressOfMember);
@@ -125,6 +151,7 @@ public:
 
 	// ring functionalities
 	void updateRing();
+	bool ringDue();
 	vector<Node> getMembershipList();
 	size_t hashFunction(string key);
 	void findNeighbors();
@@ -137,16 +164,28 @@ public:
 
 	// receive messages from Emulnet
 	bool recvLoop();
-	static int enqueueWrapper(void *env, char *buff, int size);
+	static int enqueueWrapper(void *env, MsgBuffer *buff, int hdr);
 
 	// handle messages from receiving queue
 	void checkMessages();
+	bool busy();
+	void idleTick();
 
 	// coordinator dispatches messages to corresponding nodes
 	void dispatchMessages(Message message);
 
 	// find the addresses of nodes that are responsible for a key
 	vector<Node> findNodes(string key);
+	// send one message to all replicas of a key
+	void multicastToReplicas(string key, MsgBuffer *buf);
+	// send one message now, or later if its link has no credit left
+	void sendOrDefer(Address *to, MsgBuffer *buf, int hdr = 0);
+	void flushOutbox();
+	bool inRing(Address *addr);
+	int costOf(int msgType);
+	vector<long> &getDepthHistogram() {
+		return depthHist;
+	}
 
 	// server
 	bool createKeyValue(string key, string value, ReplicaType replica);
@@ -158,9 +197,9 @@ public:
 	void stabilizationProtocol(vector<Node>&, vector<Node>&);
 
 	// custom
-	void handleCreate(char* data, int size);
+	void handleCreate(char* data, int size, ReplicaType replica);
 	void handleRead(char* data, int size);
-	void handleUpdate(char* data, int size);
+	void handleUpdate(char* data, int size, ReplicaType replica);
 	void handleDelete(char* data, int size);
 	void handleReply(char* data, int size);
 	void handleReadReply(char* data, int size);
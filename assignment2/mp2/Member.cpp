@@ -9,7 +9,7 @@
 /**
  * Constructor
  */
-q_elt::q_elt(void *elt, int size): elt(elt), size(size) {}
+q_elt::q_elt(MsgBuffer *buf, int hdr): elt(buf->data()), size(buf->size), hdr(hdr), buf(buf) {}
 
 /**
  * Copy constructor
@@ -152,9 +152,12 @@ Member::Member(const Member &anotherMember) {
 	this->pingCounter = anotherMember.pingCounter;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
+	this->listVersion = anotherMember.listVersion;
+	this->memberSlot = anotherMember.memberSlot;
 	this->myPos = anotherMember.myPos;
 	this->mp1q = anotherMember.mp1q;
 	this->mp2q = anotherMember.mp2q;
+	this->rng = anotherMember.rng;
 }
 
 /**
@@ -170,8 +173,11 @@ Member& Member::operator =(const Member& anotherMember) {
 	this->pingCounter = anotherMember.pingCounter;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
+	this->listVersion = anotherMember.listVersion;
+	this->memberSlot = anotherMember.memberSlot;
 	this->myPos = anotherMember.myPos;
 	this->mp1q = anotherMember.mp1q;
 	this->mp2q = anotherMember.mp2q;
+	this->rng = anotherMember.rng;
 	return *this;
 }
@@ -8,17 +8,24 @@
 #define MEMBER_H_
 
 #include "stdincludes.h"
+#include "MsgPool.h"
+#include "Rng.h"
 
 /**
  * CLASS NAME: q_elt
  *
  * DESCRIPTION: Entry in the queue
+ * 				The entry owns one reference to buf; elt and size point into it.
+ * 				hdr is the per-destination header the sender attached to this copy.
+ * 				Release buf once the message has been handled.
  */
 class q_elt {
 public:
 	void *elt;
 	int size;
-	q_elt(void *elt, int size);
+	int hdr;
+	MsgBuffer *buf;
+	q_elt(MsgBuffer *buf, int hdr);
 };
 
 /**
@@ -106,16 +113,22 @@ public:
 	int timeOutCounter;
 	// Membership table
 	vector<MemberListEntry> memberList;
+	// Bumped whenever a member is added to or removed from memberList
+	unsigned long listVersion;
+	// Slot of each id in memberList, indexed by id; -1 for ids not in it
+	vector<int> memberSlot;
 	// My position in the membership table
 	vector<MemberListEntry>::iterator myPos;
 	// Queue for failure detection messages
 	queue<q_elt> mp1q;
 	// Queue for KVstore messages
 	queue<q_elt> mp2q;
+	// This member's own random stream
+	Rng rng;
 	/**
 	 * Constructor
 	 */
-	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0) {}
+	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0), listVersion(0) {}
 	// copy constructor
 	Member(const Member &anotherMember);
 	// Assignment operator overloading
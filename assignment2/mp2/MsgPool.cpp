@@ -0,0 +1,158 @@
+/**********************************
+ * FILE NAME: MsgPool.cpp
+ *
+ * DESCRIPTION: Definition of the MsgPool class
+ **********************************/
+
+#include "MsgPool.h"
+
+/**
+ * Constructor
+ */
+MsgPool::MsgPool(): inUse(0), peakInUse(0), locked(false) {
+	for ( int i = 0; i < POOL_NUM_CLASSES; i++ ) {
+		freeList[i] = NULL;
+	}
+}
+
+/**
+ * Destructor
+ */
+MsgPool::~MsgPool() {
+	for ( unsigned int i = 0; i < slabs.size(); i++ ) {
+		free(slabs[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: sizeClass
+ *
+ * DESCRIPTION: Returns the smallest size class that fits bytes, or -1 if none does
+ */
+int MsgPool::sizeClass(int bytes) {
+	int cls = 0;
+	while ( cls < POOL_NUM_CLASSES && frameSize(cls) < bytes ) {
+		cls++;
+	}
+	return cls < POOL_NUM_CLASSES ? cls : -1;
+}
+
+/**
+ * FUNCTION NAME: frameSize
+ *
+ * DESCRIPTION: Returns the size of the frames of a size class
+ */
+int MsgPool::frameSize(int cls) {
+	return POOL_MIN_FRAME << cls;
+}
+
+/**
+ * FUNCTION NAME: refill
+ *
+ * DESCRIPTION: Carves a new slab into frames and pushes them on the free list of cls
+ */
+void MsgPool::refill(int cls) {
+	int size = frameSize(cls);
+	char *slab = (char *) malloc(POOL_SLAB_SIZE);
+	slabs.push_back(slab);
+
+	for ( int off = POOL_SLAB_SIZE - size; off >= 0; off -= size ) {
+		*(void **)(slab + off) = freeList[cls];
+		freeList[cls] = slab + off;
+	}
+}
+
+/**
+ * FUNCTION NAME: alloc
+ *
+ * DESCRIPTION: Returns a frame of at least bytes bytes
+ */
+void *MsgPool::alloc(int bytes) {
+	if ( locked ) {
+		std::lock_guard<std::mutex> guard(lock);
+		return allocFrame(bytes);
+	}
+	return allocFrame(bytes);
+}
+
+/**
+ * FUNCTION NAME: allocFrame
+ *
+ * DESCRIPTION: alloc, once the caller has the pool to itself
+ */
+void *MsgPool::allocFrame(int bytes) {
+	void *frame;
+	int cls = sizeClass(bytes);
+
+	if ( cls < 0 ) {
+		frame = malloc(bytes);
+	}
+	else {
+		if ( NULL == freeList[cls] ) {
+			refill(cls);
+		}
+		frame = freeList[cls];
+		freeList[cls] = *(void **)frame;
+	}
+
+	if ( ++inUse > peakInUse ) {
+		peakInUse = inUse;
+	}
+	return frame;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Returns a frame obtained from alloc(bytes) to its free list
+ */
+void MsgPool::release(void *frame, int bytes) {
+	if ( locked ) {
+		std::lock_guard<std::mutex> guard(lock);
+		releaseFrame(frame, bytes);
+		return;
+	}
+	releaseFrame(frame, bytes);
+}
+
+/**
+ * FUNCTION NAME: releaseFrame
+ *
+ * DESCRIPTION: release, once the caller has the pool to itself
+ */
+void MsgPool::releaseFrame(void *frame, int bytes) {
+	int cls = sizeClass(bytes);
+
+	if ( cls < 0 ) {
+		free(frame);
+	}
+	else {
+		*(void **)frame = freeList[cls];
+		freeList[cls] = frame;
+	}
+	inUse--;
+}
+
+/**
+ * FUNCTION NAME: allocBuffer
+ *
+ * DESCRIPTION: Returns a MsgBuffer with room for size bytes of payload and one reference
+ */
+MsgBuffer *MsgPool::allocBuffer(int size) {
+	MsgBuffer *buf = (MsgBuffer *) alloc(sizeof(MsgBuffer) + size);
+	buf->pool = this;
+	buf->refs = 1;
+	buf->size = size;
+	return buf;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Drops one reference, returning the frame to the pool on the last one
+ */
+void MsgBuffer::release() {
+	if ( 0 == __atomic_sub_fetch(&refs, 1, __ATOMIC_ACQ_REL) ) {
+		pool->release(this, sizeof(MsgBuffer) + size);
+	}
+}
@@ -0,0 +1,95 @@
+/**********************************
+ * FILE NAME: MsgPool.h
+ *
+ * DESCRIPTION: Header file of the MsgPool class
+ **********************************/
+
+#ifndef MSGPOOL_H_
+#define MSGPOOL_H_
+
+#include "stdincludes.h"
+#include <mutex>
+
+/*
+ * Macros
+ */
+// Smallest frame handed out by the pool, in bytes
+#define POOL_MIN_FRAME 64
+// Number of size classes; frames double in size from one class to the next
+#define POOL_NUM_CLASSES 8
+// Bytes requested from malloc each time a size class runs dry
+#define POOL_SLAB_SIZE (64 * 1024)
+
+class MsgPool;
+
+/**
+ * CLASS NAME: MsgBuffer
+ *
+ * DESCRIPTION: Reference counted message payload living in a MsgPool frame.
+ * 				The size bytes of the payload follow the header in the same frame.
+ * 				Whoever holds a reference calls release() when done with it; the
+ * 				frame goes back to its pool once the last reference is released.
+ * 				References may be taken and dropped on different threads.
+ */
+class MsgBuffer {
+public:
+	MsgPool *pool;
+	int refs;
+	int size;
+	char *data() {
+		return (char *)(this + 1);
+	}
+	MsgBuffer *retain() {
+		__atomic_add_fetch(&refs, 1, __ATOMIC_RELAXED);
+		return this;
+	}
+	void release();
+};
+
+/**
+ * CLASS NAME: MsgPool
+ *
+ * DESCRIPTION: Size-classed slab allocator for message frames.
+ * 				Frames are carved out of large slabs and recycled through a free list
+ * 				per size class, so sending a message does not cost a malloc/free.
+ * 				Requests larger than the biggest class fall back to malloc.
+ * 				Once setLocked(true), frames may be allocated and released on any thread.
+ */
+class MsgPool {
+private:
+	// Head of the free list of each size class
+	void *freeList[POOL_NUM_CLASSES];
+	// Every slab ever allocated, released when the pool goes away
+	vector<char *> slabs;
+	// Frames currently handed out
+	long inUse;
+	// Highest value inUse has reached
+	long peakInUse;
+	bool locked;
+	std::mutex lock;
+	int sizeClass(int bytes);
+	int frameSize(int cls);
+	void refill(int cls);
+	void *allocFrame(int bytes);
+	void releaseFrame(void *frame, int bytes);
+public:
+	MsgPool();
+	virtual ~MsgPool();
+	void *alloc(int bytes);
+	void release(void *frame, int bytes);
+	MsgBuffer *allocBuffer(int size);
+	void setLocked(bool locked) {
+		this->locked = locked;
+	}
+	long getInUse() {
+		return inUse;
+	}
+	long getPeakInUse() {
+		return peakInUse;
+	}
+	long getSlabBytes() {
+		return (long)slabs.size() * POOL_SLAB_SIZE;
+	}
+};
+
+#endif /* MSGPOOL_H_ */
@@ -6,6 +6,8 @@
 
 #include "Node.h"
 
+size_t Node::ringSize = RINGSIZE;
+
 /**
  * constructor
  */
@@ -30,7 +32,7 @@ Node::~Node() {}
  * DESCRIPTION: This function computes the hash code of the node address
  */
 void Node::computeHashCode() {
-	nodeHashCode = hashFunc(nodeAddress.addr)%RING_SIZE;
+	nodeHashCode = hashFunc(nodeAddress.addr)%ringSize;
 }
 
 /**
@@ -15,6 +15,8 @@ public:
 	Address nodeAddress;
 	size_t nodeHashCode;
 	std::hash<string> hashFunc;
+	// Positions on the ring, RING_SIZE of the test case
+	static size_t ringSize;
 	Node();
 	Node(Address address);
 	Node(const Node& another);
@@ -9,7 +9,7 @@
 /**
  * Constructor
  */
-Params::Params(): PORTNUM(8001) {}
+Params::Params(): SELF(-1), WORKER(-1), PORTNUM(8001) {}
 
 /**
  * FUNCTION NAME: setparams
@@ -18,37 +18,148 @@ Params::Params(): PORTNUM(8001) {}
  */
 void Params::setparams(char *config_file) {
 	//trace.funcEntry("Params::setparams");
-	char CRUD[10];
+	char line[256], key[64], value[192];
 	FILE *fp = fopen(config_file,"r");
 
-	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
-	fscanf(fp,"\nSINGLE_FAILURE: %d", &SINGLE_FAILURE);
-	fscanf(fp,"\nDROP_MSG: %d", &DROP_MSG);
-	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
-	fscanf(fp,"\nCRUD_TEST: %s", CRUD);
+	// Every line of the test case is a "KEY: value" pair, in any order.
+	// FAULT is the one key that may appear more than once.
+	config.clear();
+	FAULTS.clear();
+	while ( fgets(line, sizeof(line), fp) ) {
+		if ( 2 == sscanf(line, " %63[^: ] : %191[^\r\n]", key, value) ) {
+			config[key] = value;
+			if ( 0 == strcmp(key, "FAULT") ) {
+				FAULTS.push_back(value);
+			}
+		}
+	}
+
+	MAX_NNB = getint("MAX_NNB", 0);
+	SINGLE_FAILURE = getint("SINGLE_FAILURE", 0);
+	DROP_MSG = getint("DROP_MSG", 0);
+	MSG_DROP_PROB = getdouble("MSG_DROP_PROB", 0);
+	string CRUD = getstring("CRUD_TEST", "");
 
-	if ( 0 == strcmp(CRUD, "CREATE") ) {
+	if ( "CREATE" == CRUD ) {
 		this->CRUDTEST = CREATE_TEST;
 	}
-	else if ( 0 == strcmp(CRUD, "READ") ) {
+	else if ( "READ" == CRUD ) {
 		this->CRUDTEST = READ_TEST;
 	}
-	else if ( 0 == strcmp(CRUD, "UPDATE") ) {
+	else if ( "UPDATE" == CRUD ) {
 		this->CRUDTEST = UPDATE_TEST;
 	}
-	else if ( 0 == strcmp(CRUD, "DELETE") ) {
+	else if ( "DELETE" == CRUD ) {
 		this->CRUDTEST = DELETE_TEST;
 	}
 
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
 	EN_GPSZ = MAX_NNB;
-	STEP_RATE=.25;
-	MAX_MSG_SIZE = 4000;
+	EN_BUFFSIZE = getint("EN_BUFFSIZE", ENBUFFSIZE);
+	EN_FIFO = getint("EN_FIFO", 0);
+
+	string latency = getstring("LATENCY", "NONE");
+	if ( "FIXED" == latency ) {
+		LATENCY = FIXED_LATENCY;
+	}
+	else if ( "UNIFORM" == latency ) {
+		LATENCY = UNIFORM_LATENCY;
+	}
+	else if ( "LOGNORMAL" == latency ) {
+		LATENCY = LOGNORMAL_LATENCY;
+	}
+	else {
+		LATENCY = NO_LATENCY;
+	}
+	LATENCY_MIN = getint("LATENCY_MIN", 0);
+	// A lognormal latency is only bounded by the length of the run unless told otherwise
+	LATENCY_MAX = getint("LATENCY_MAX", LOGNORMAL_LATENCY == LATENCY ? getint("TOTAL_RUNNING_TIME", 700) : LATENCY_MIN);
+	LATENCY_MU = getdouble("LATENCY_MU", 0);
+	LATENCY_SIGMA = getdouble("LATENCY_SIGMA", 0);
+	if ( LATENCY_MIN < 0 || LATENCY_MAX < LATENCY_MIN ) {
+		fprintf(stderr, "LATENCY_MIN must be at least 0 and no more than LATENCY_MAX\n");
+		exit(1);
+	}
+	if ( LATENCY_SIGMA < 0 ) {
+		fprintf(stderr, "LATENCY_SIGMA must be at least 0\n");
+		exit(1);
+	}
+
+	string transport = getstring("TRANSPORT", "EMULNET");
+	if ( "UDP" == transport ) {
+		TRANSPORT = UDP_TRANSPORT;
+	}
+	else if ( "SHM" == transport ) {
+		TRANSPORT = SHM_TRANSPORT;
+	}
+	else {
+		TRANSPORT = EMULNET_TRANSPORT;
+	}
+	UDP_BASEPORT = getint("UDP_BASEPORT", UDPBASEPORT);
+	UDP_TICK_MS = getint("UDP_TICK_MS", 0);
+	UDP_START = atol(getstring("UDP_START", "0").c_str());
+	// A run without a SEED gets a fresh one; Application prints it so the run can be repeated
+	string seed = getstring("SEED", "");
+	SEED = seed.empty() ? (unsigned long)time(NULL) : strtoul(seed.c_str(), NULL, 10);
+	WORKERS = getint("WORKERS", 1);
+	THREADS = getint("THREADS", 1);
+	SCHEDULER = "EVENT" == getstring("SCHEDULER", "TICK") ? EVENT_SCHEDULER : TICK_SCHEDULER;
+	SHM_RING_BYTES = atol(getstring("SHM_RING_BYTES", to_string(SHMRINGBYTES)).c_str());
+	CAPTURE = getstring("CAPTURE", "");
+	REPLAY = getstring("REPLAY", "");
+	TRAFFIC_BUCKET = getint("TRAFFIC_BUCKET", 0);
+	LINK_CREDITS = getint("LINK_CREDITS", 0);
+	CPU_BUDGET = getint("CPU_BUDGET", 0);
+	SERVICE_COST = getint("SERVICE_COST", 1);
+	NIC_EGRESS_BYTES = getint("NIC_EGRESS_BYTES", 0);
+	NIC_INGRESS_BYTES = getint("NIC_INGRESS_BYTES", 0);
+	STEP_RATE = getdouble("STEP_RATE", .25);
+	MAX_MSG_SIZE = getint("MAX_MSG_SIZE", 4000);
+	// The test schedule keeps its shape when only the length of the run is changed
+	TOTAL_RUNNING_TIME = getint("TOTAL_RUNNING_TIME", 700);
+	INSERT_TIME = getint("INSERT_TIME", TOTAL_RUNNING_TIME - 600);
+	TEST_TIME = getint("TEST_TIME", INSERT_TIME + 50);
+	STABILIZE_TIME = getint("STABILIZE_TIME", 50);
+	FIRST_FAIL_TIME = getint("FIRST_FAIL_TIME", 25);
+	LAST_FAIL_TIME = getint("LAST_FAIL_TIME", 10);
+	NUMBER_OF_INSERTS = getint("NUMBER_OF_INSERTS", 100);
+	KEY_LENGTH = getint("KEY_LENGTH", 5);
+	RING_SIZE = getint("RING_SIZE", RINGSIZE);
+	string gossip = getstring("GOSSIP", "FULL");
+	if ( "DELTA" == gossip ) {
+		GOSSIP = DELTA_GOSSIP;
+	}
+	else if ( "SWIM" == gossip ) {
+		GOSSIP = SWIM_GOSSIP;
+	}
+	else {
+		GOSSIP = FULL_GOSSIP;
+	}
+	GOSSIP_PERIOD = max(getint("GOSSIP_PERIOD", 50), 1);
+	GOSSIP_FANOUT = max(getint("GOSSIP_FANOUT", 2), 1);
+	GOSSIP_ROTATE = getint("GOSSIP_ROTATE", 100);
+	// A member announces a new heartbeat only every GOSSIP_PERIOD ticks with DELTA gossip,
+	// so the timeouts leave room for that on top of the time it takes to spread
+	FAIL_TIMEOUT = getint("FAIL_TIMEOUT", DELTA_GOSSIP == GOSSIP ? GOSSIP_PERIOD + 4 * TFAIL : TFAIL);
+	REMOVE_TIMEOUT = getint("REMOVE_TIMEOUT", FAIL_TIMEOUT + TREMOVE - TFAIL);
+	DETECTOR = "PHI" == getstring("DETECTOR", "FIXED") ? PHI_DETECTOR : FIXED_DETECTOR;
+	PHI_THRESHOLD = getdouble("PHI_THRESHOLD", 8);
+	PHI_WINDOW = max(getint("PHI_WINDOW", 100), 1);
+	PHI_MIN_STD = getdouble("PHI_MIN_STD", 1);
+	// An ack to a direct probe is back in 2 ticks, one relayed by a helper in 4 more
+	SWIM_TIMEOUT = max(getint("SWIM_TIMEOUT", 2), 1);
+	SWIM_PERIOD = max(getint("SWIM_PERIOD", 3 * SWIM_TIMEOUT), SWIM_TIMEOUT + 1);
+	SWIM_HELPERS = getint("SWIM_HELPERS", 3);
+	SWIM_SUSPECT = getint("SWIM_SUSPECT", 4 * SWIM_PERIOD);
+	SWIM_PIGGYBACK = max(getint("SWIM_PIGGYBACK", 32), 1);
+	SWIM_RETRANSMIT = max(getint("SWIM_RETRANSMIT", 3), 1);
+	// Updates that run out of retransmissions before reaching everybody are made up for here
+	SWIM_SYNC = getint("SWIM_SYNC", 10);
 	globaltime = 0;
 	dropmsg = 0;
 	allNodesJoined = 0;
-	for ( unsigned int i = 0; i < EN_GPSZ; i++ ) {
+	for ( int i = 0; i < EN_GPSZ; i++ ) {
 		allNodesJoined += i;
 	}
 	fclose(fp);
@@ -56,6 +167,36 @@ void Params::setparams(char *config_file) {
 	return;
 }
 
+/**
+ * FUNCTION NAME: getstring
+ *
+ * DESCRIPTION: Return the value of key in the test case, or def if it is not set
+ */
+string Params::getstring(const char *key, string def) {
+	map<string, string>::iterator search = config.find(key);
+	return search != config.end() ? search->second : def;
+}
+
+/**
+ * FUNCTION NAME: getint
+ *
+ * DESCRIPTION: Return the integer value of key in the test case, or def if it is not set
+ */
+int Params::getint(const char *key, int def) {
+	map<string, string>::iterator search = config.find(key);
+	return search != config.end() ? atoi(search->second.c_str()) : def;
+}
+
+/**
+ * FUNCTION NAME: getdouble
+ *
+ * DESCRIPTION: Return the floating point value of key in the test case, or def if it is not set
+ */
+double Params::getdouble(const char *key, double def) {
+	map<string, string>::iterator search = config.find(key);
+	return search != config.end() ? atof(search->second.c_str()) : def;
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
@@ -65,3 +206,44 @@ void Params::setparams(char *config_file) {
 int Params::getcurrtime(){
     return globaltime;
 }
+
+/**
+ * FUNCTION NAME: workerOf
+ *
+ * DESCRIPTION: Index of the worker process running the ith node; each worker runs a
+ * 				contiguous slice of the nodes
+ */
+int Params::workerOf(int i) {
+	return (int)((long)i * WORKERS / EN_GPSZ);
+}
+
+/**
+ * FUNCTION NAME: runsNode
+ *
+ * DESCRIPTION: Whether the ith node is run by this process
+ */
+bool Params::runsNode(int i) {
+	if ( SELF >= 0 ) {
+		return SELF == i;
+	}
+	if ( WORKER >= 0 ) {
+		return workerOf(i) == WORKER;
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: filePrefix
+ *
+ * DESCRIPTION: Prefix of the log files of this process, so that the processes of a
+ * 				multi-process run do not write over each other
+ */
+string Params::filePrefix() {
+	if ( SELF >= 0 ) {
+		return to_string(SELF) + ".";
+	}
+	if ( WORKER >= 0 ) {
+		return "w" + to_string(WORKER) + ".";
+	}
+	return "";
+}
@@ -11,7 +11,29 @@
 #include "Params.h"
 #include "Member.h"
 
+/*
+ * Macros
+ */
+// Default high-water mark of messages in flight in an EmulNet
+#define ENBUFFSIZE 30000
+// Default first local UDP port; node id n of the MP1 network listens on UDPBASEPORT + n
+#define UDPBASEPORT 20000
+// Default length of a tick, in milliseconds, when nodes run as separate processes
+#define UDPTICKMS 10
+// Default bytes of each shared-memory ring between two worker processes
+#define SHMRINGBYTES (4 * 1024 * 1024)
+// Default ticks without a new heartbeat before a member is no longer gossiped, and removed
+#define TFAIL 5
+#define TREMOVE 20
+// Heartbeat intervals of a member the phi detector waits for before it judges it
+#define PHISAMPLES 3
+
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
+enum latencyTYPE { NO_LATENCY, FIXED_LATENCY, UNIFORM_LATENCY, LOGNORMAL_LATENCY };
+enum transportTYPE { EMULNET_TRANSPORT, UDP_TRANSPORT, SHM_TRANSPORT };
+enum schedulerTYPE { TICK_SCHEDULER, EVENT_SCHEDULER };
+enum gossipTYPE { FULL_GOSSIP, DELTA_GOSSIP, SWIM_GOSSIP };
+enum detectorTYPE { FIXED_DETECTOR, PHI_DETECTOR };
 
 /**
  * CLASS NAME: Params
@@ -24,17 +46,77 @@ public:
 	int SINGLE_FAILURE;			// single/multi failure
 	double MSG_DROP_PROB;		// message drop probability
 	double STEP_RATE;		    // dictates the rate of insertion
+	int TOTAL_RUNNING_TIME;		// ticks the run lasts
+	int INSERT_TIME;			// tick the test keys are inserted in
+	int TEST_TIME;				// tick the CRUD test starts in
+	int STABILIZE_TIME;			// ticks the tests leave the stabilization protocol after failing replicas
+	int FIRST_FAIL_TIME;		// ticks from TEST_TIME to the first failure of the read and update tests
+	int LAST_FAIL_TIME;			// ticks from the second stabilization to the failure of a non-replica
+	int NUMBER_OF_INSERTS;		// test keys inserted
+	int KEY_LENGTH;				// characters of each test key
+	int RING_SIZE;				// positions on the consistent hashing ring
+	int GOSSIP;					// gossipTYPE of the membership protocol
+	int GOSSIP_PERIOD;			// ticks between the heartbeats a node announces with DELTA gossip
+	int GOSSIP_FANOUT;			// partners each node exchanges deltas with
+	int GOSSIP_ROTATE;			// ticks between replacing one of them by a random member, 0 for never
+	int FAIL_TIMEOUT;			// ticks without a new heartbeat before a member is no longer gossiped
+	int REMOVE_TIMEOUT;			// ticks without a new heartbeat before a member is removed
+	int DETECTOR;				// detectorTYPE judging when a member without new heartbeats failed
+	double PHI_THRESHOLD;		// phi beyond which the PHI detector takes a member as failed
+	int PHI_WINDOW;				// heartbeat intervals the statistics of a member mostly come from
+	double PHI_MIN_STD;			// lower bound of their standard deviation, in ticks
+	int SWIM_TIMEOUT;			// ticks a SWIM probe waits for an ack before asking helpers
+	int SWIM_PERIOD;			// ticks between the probes of a SWIM node
+	int SWIM_HELPERS;			// members asked to probe on a node's behalf when it gets no ack
+	int SWIM_SUSPECT;			// ticks a member stays suspected before it is removed
+	int SWIM_PIGGYBACK;			// membership updates carried by each SWIM message
+	int SWIM_RETRANSMIT;		// times an update is sent, per doubling of the group
+	int SWIM_SYNC;				// SWIM periods between syncs with a random member; 0 for none
 	int EN_GPSZ;			    // actual number of peers
 	int MAX_MSG_SIZE;
+	int EN_BUFFSIZE;			// max number of messages in flight in an EmulNet
+	int EN_FIFO;				// deliver the messages of each link in the order they were sent
+	int LATENCY;				// latencyTYPE of every link
+	int LATENCY_MIN;			// fixed latency, or lower bound of uniform and lognormal latency, in ticks
+	int LATENCY_MAX;			// upper bound of uniform and lognormal latency, in ticks
+	double LATENCY_MU;			// lognormal latency is exp(N(LATENCY_MU, LATENCY_SIGMA)) ticks
+	double LATENCY_SIGMA;
+	int TRANSPORT;				// transportTYPE the nodes talk over
+	int UDP_BASEPORT;			// first local port of the UDP transport
+	int UDP_TICK_MS;			// wall-clock length of a tick, 0 to run ticks back to back
+	long UDP_START;				// unix time in seconds at which tick 0 starts, 0 for right away
+	int SELF;					// index of the only node this process runs, -1 for all of them
+	int WORKERS;				// number of worker processes sharing the nodes of the SHM transport
+	int WORKER;					// index of this worker process, -1 when there is only one
+	int THREADS;				// threads stepping the nodes of the emulated network
+	int SCHEDULER;				// schedulerTYPE deciding which nodes and ticks are stepped
+	long SHM_RING_BYTES;		// bytes of each ring between two worker processes
+	string CAPTURE;				// prefix of the files every sent message is recorded in, empty for none
+	string REPLAY;				// MP2 capture file to replay instead of running the test case
+	int TRAFFIC_BUCKET;			// ticks per row of the traffic breakdown, 0 for none
+	vector<string> FAULTS;		// FAULT lines of the test case, see FaultSchedule
+	int NIC_EGRESS_BYTES;		// bytes each node sends per tick, 0 for no limit
+	int NIC_INGRESS_BYTES;		// bytes each node takes in per tick, 0 for no limit
+	int CPU_BUDGET;				// CPU each MP2 node has per tick to handle messages, 0 for no limit
+	int SERVICE_COST;			// CPU a message takes, unless SERVICE_COST_<TYPE> says otherwise
+	int LINK_CREDITS;			// messages a link holds before its receiver takes them in, 0 for no limit
 	int DROP_MSG;
 	int dropmsg;
 	int globaltime;
-	int allNodesJoined;
+	long allNodesJoined;
 	short PORTNUM;
 	int CRUDTEST;
+	unsigned long SEED;			// seed every random stream of the run derives from
+	map<string, string> config; // raw "KEY: value" pairs of the test case
 	Params();
 	void setparams(char *);
+	string getstring(const char *key, string def);
+	int getint(const char *key, int def);
+	double getdouble(const char *key, double def);
 	int getcurrtime();
+	int workerOf(int i);
+	bool runsNode(int i);
+	string filePrefix();
 };
 
 #endif /* _PARAMS_H_ */
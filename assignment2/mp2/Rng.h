@@ -0,0 +1,88 @@
+/**********************************
+ * FILE NAME: Rng.h
+ *
+ * DESCRIPTION: Header file of the Rng class
+ **********************************/
+
+#ifndef RNG_H_
+#define RNG_H_
+
+#include <stdint.h>
+
+/*
+ * Who draws from a stream. Together with an id, it picks one of the independent
+ * streams derived from the seed of the run.
+ */
+enum rngSTREAM { NODE_STREAM, APP_STREAM, NET_STREAM, WORKLOAD_STREAM };
+
+/**
+ * CLASS NAME: Rng
+ *
+ * DESCRIPTION: xoshiro256** generator seeded through splitmix64.
+ * 				Every node, network and the application driver own their own Rng, derived
+ * 				from the run's seed and a stream, so draws are reproducible, cost a few
+ * 				instructions and share no state with anybody else.
+ */
+class Rng {
+private:
+	uint64_t s[4];
+
+	static uint64_t splitmix(uint64_t &x) {
+		uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+public:
+	Rng() {
+		seed(0, NODE_STREAM, 0);
+	}
+
+	Rng(uint64_t seed, int kind, int id) {
+		this->seed(seed, kind, id);
+	}
+
+	/**
+	 * Restart as stream (kind, id) of seed
+	 */
+	void seed(uint64_t seed, int kind, int id) {
+		uint64_t stream = ((uint64_t)kind << 32) | (uint32_t)id;
+		uint64_t x = seed ^ splitmix(stream);
+		for ( int i = 0; i < 4; i++ ) {
+			s[i] = splitmix(x);
+		}
+	}
+
+	uint64_t next() {
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+
+	/**
+	 * Uniform integer in [0, n), n > 0
+	 */
+	int nextInt(int n) {
+		return (int)(((next() >> 32) * (uint64_t)n) >> 32);
+	}
+
+	/**
+	 * Uniform double in (0, 1)
+	 */
+	double nextDouble() {
+		return ((next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+	}
+};
+
+#endif /* RNG_H_ */
@@ -0,0 +1,188 @@
+/**********************************
+ * FILE NAME: ShmNet.cpp
+ *
+ * DESCRIPTION: Definition of the ShmNet class
+ **********************************/
+
+#include "ShmNet.h"
+
+/**
+ * Constructor
+ *
+ * Maps the rings of every pair of workers. Must run before the workers are forked,
+ * so that they all share the mapping.
+ */
+ShmNet::ShmNet(Params *p, int workers, long ringBytes, int netId): EmulNet(p, netId), workers(workers) {
+	// Records are 8-byte aligned, so is the ring
+	this->ringBytes = (ringBytes + 7) & ~7L;
+	regionSize = (size_t)workers * workers * (sizeof(shm_ring) + this->ringBytes);
+	region = (char *) mmap(NULL, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if ( MAP_FAILED == region ) {
+		perror("mmap");
+		exit(1);
+	}
+	for ( int src = 0; src < workers; src++ ) {
+		for ( int dst = 0; dst < workers; dst++ ) {
+			shm_ring *r = ring(src, dst);
+			new (&r->head) std::atomic<unsigned long>(0);
+			new (&r->tail) std::atomic<unsigned long>(0);
+		}
+	}
+}
+
+/**
+ * Destructor
+ */
+ShmNet::~ShmNet() {
+	munmap(region, regionSize);
+}
+
+/**
+ * FUNCTION NAME: ring
+ *
+ * DESCRIPTION: Ring carrying the messages from worker src to worker dst
+ */
+shm_ring *ShmNet::ring(int src, int dst) {
+	return (shm_ring *)(region + ((size_t)src * workers + dst) * (sizeof(shm_ring) + ringBytes));
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Copies a message into r. Only the sending worker of r calls this.
+ *
+ * RETURNS:
+ * false if r has no room for it
+ */
+bool ShmNet::push(shm_ring *r, shm_rec &rec, MsgBuffer *buf) {
+	unsigned long head = r->head.load(std::memory_order_acquire);
+	unsigned long tail = r->tail.load(std::memory_order_relaxed);
+	long need = (sizeof(shm_rec) + buf->size + 7) & ~7L;
+	long pos = tail % ringBytes;
+	// A record never wraps; the bytes left at the end are skipped instead
+	long skip = ( pos + need > ringBytes ) ? ringBytes - pos : 0;
+
+	if ( need > ringBytes || (long)(tail - head) + skip + need > ringBytes ) {
+		return false;
+	}
+	if ( skip > 0 ) {
+		((shm_rec *)(r->data() + pos))->size = -1;
+		pos = 0;
+	}
+	memcpy(r->data() + pos, &rec, sizeof(shm_rec));
+	memcpy(r->data() + pos + sizeof(shm_rec), buf->data(), buf->size);
+	r->tail.store(tail + skip + need, std::memory_order_release);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: pull
+ *
+ * DESCRIPTION: Moves every message in r into the mailboxes or onto the wire.
+ * 				Only the receiving worker of r calls this.
+ *
+ * RETURNS:
+ * number of messages moved
+ */
+int ShmNet::pull(shm_ring *r) {
+	unsigned long head = r->head.load(std::memory_order_relaxed);
+	unsigned long tail = r->tail.load(std::memory_order_acquire);
+	int got = 0;
+
+	while ( head < tail ) {
+		long pos = head % ringBytes;
+		shm_rec rec;
+		memcpy(&rec, r->data() + pos, sizeof(shm_rec));
+		if ( rec.size < 0 ) {
+			head += ringBytes - pos;
+			continue;
+		}
+
+		en_msg em;
+		em.size = rec.size;
+		memcpy(em.from.addr, rec.from, sizeof(em.from.addr));
+		memcpy(em.to.addr, rec.to, sizeof(em.to.addr));
+		em.buf = ENalloc(rec.size);
+		memcpy(em.buf->data(), r->data() + pos + sizeof(shm_rec), rec.size);
+		em.hdr = rec.hdr;
+		deliver(em, rec.due);
+
+		head += (sizeof(shm_rec) + rec.size + 7) & ~7L;
+		got++;
+	}
+
+	r->head.store(head, std::memory_order_release);
+	return got;
+}
+
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: Sends a message to a node of this worker through EmulNet, or to a node of
+ * 				another worker through their ring.
+ * 				Takes over the caller's reference to buf, whether or not the message is sent.
+ *
+ * RETURNS:
+ * size
+ */
+int ShmNet::ENsend(Address *myaddr, Address *toaddr, MsgBuffer *buf, int hdr) {
+	shm_rec rec;
+	int size = buf->size;
+	int dst = par->workerOf(*(int *)(toaddr->addr) - 1);
+
+	if ( par->WORKER < 0 || dst == par->WORKER ) {
+		return EmulNet::ENsend(myaddr, toaddr, buf, hdr);
+	}
+
+	int sendmsg = rngOf(*(int *)(myaddr->addr)).nextInt(100);
+	if ( size + (int)sizeof(MsgBuffer) >= par->MAX_MSG_SIZE ) {
+		return dropMsg(myaddr, buf, OVERSIZE_DROP);
+	}
+	if ( par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100) ) {
+		return dropMsg(myaddr, buf, RANDOM_DROP);
+	}
+	int fault = linkFault(myaddr, toaddr, buf);
+	if ( SENT_TRAFFIC != fault ) {
+		return dropMsg(myaddr, buf, fault);
+	}
+
+	rec.size = size;
+	rec.hdr = hdr;
+	// The receiver's ingress is booked on this worker's clock, which only sees what this worker sends it
+	rec.due = sendDue(myaddr, toaddr, size);
+	memcpy(rec.from, myaddr->addr, sizeof(rec.from));
+	memcpy(rec.to, toaddr->addr, sizeof(rec.to));
+	if ( !push(ring(par->WORKER, dst), rec, buf) ) {
+		return dropMsg(myaddr, buf, BUFFER_FULL_DROP);
+	}
+	captureMsg(myaddr, toaddr, buf, hdr, rec.due);
+	countTraffic(myaddr, buf, SENT_TRAFFIC);
+	buf->release();
+
+	countMsg(sent_msgs, *(int *)(myaddr->addr), par->getcurrtime());
+
+	return size;
+}
+
+/**
+ * FUNCTION NAME: ENpoll
+ *
+ * DESCRIPTION: Takes in the messages the other workers sent to this one.
+ * 				Never waits: the caller holds every worker at a barrier around it.
+ *
+ * RETURN:
+ * number of messages picked up
+ */
+int ShmNet::ENpoll(int timeoutms) {
+	int got = 0;
+
+	if ( par->WORKER < 0 ) {
+		return 0;
+	}
+	for ( int src = 0; src < workers; src++ ) {
+		if ( src != par->WORKER ) {
+			got += pull(ring(src, par->WORKER));
+		}
+	}
+	return got;
+}
@@ -0,0 +1,75 @@
+/**********************************
+ * FILE NAME: ShmNet.h
+ *
+ * DESCRIPTION: Header file of the ShmNet class
+ **********************************/
+
+#ifndef _SHMNET_H_
+#define _SHMNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include <atomic>
+#include <sys/mman.h>
+
+/**
+ * Struct Name: shm_ring
+ *
+ * DESCRIPTION: Single-producer single-consumer byte ring between two worker processes.
+ * 				head and tail only ever grow; the bytes live right after the struct.
+ */
+typedef struct shm_ring {
+	// Bytes consumed so far, written by the receiving worker only
+	std::atomic<unsigned long> head;
+	char headPad[64 - sizeof(std::atomic<unsigned long>)];
+	// Bytes produced so far, written by the sending worker only
+	std::atomic<unsigned long> tail;
+	char tailPad[64 - sizeof(std::atomic<unsigned long>)];
+	char *data() {
+		return (char *)(this + 1);
+	}
+}shm_ring;
+
+/**
+ * Struct Name: shm_rec
+ *
+ * DESCRIPTION: Header of a message in a ring, followed by its payload and padded to 8 bytes.
+ * 				A negative size marks the unused tail end of the ring before it wraps.
+ */
+typedef struct shm_rec {
+	int size;
+	int hdr;
+	// Tick the message is delivered in
+	int due;
+	char from[6];
+	char to[6];
+}shm_rec;
+
+/**
+ * CLASS NAME: ShmNet
+ *
+ * DESCRIPTION: Transport for running the nodes in several worker processes on one box.
+ * 				Messages between nodes of the same worker take the EmulNet path.
+ * 				Messages to a node of another worker are copied into the ring of that
+ * 				(sender worker, receiver worker) pair in a shared mmap region, and are
+ * 				taken out by ENpoll, which the workers call between two tick barriers.
+ * 				A message that does not fit in its ring is dropped.
+ */
+class ShmNet : public EmulNet {
+private:
+	int workers;
+	long ringBytes;
+	char *region;
+	size_t regionSize;
+	shm_ring *ring(int src, int dst);
+	bool push(shm_ring *r, shm_rec &rec, MsgBuffer *buf);
+	int pull(shm_ring *r);
+public:
+	ShmNet(Params *p, int workers, long ringBytes, int netId = 0);
+	virtual ~ShmNet();
+	using EmulNet::ENsend;
+	int ENsend(Address *myaddr, Address *toaddr, MsgBuffer *buf, int hdr = 0);
+	int ENpoll(int timeoutms);
+};
+
+#endif /* _SHMNET_H_ */
@@ -0,0 +1,151 @@
+/**********************************
+ * FILE NAME: ThreadPool.cpp
+ *
+ * DESCRIPTION: Definition of the ThreadPool class
+ **********************************/
+
+#include "ThreadPool.h"
+
+// Index of the pool thread running the caller, 0 for any thread outside a pool
+thread_local int ThreadPool::self = 0;
+
+/**
+ * Constructor
+ *
+ * Starts n - 1 threads; the one calling run() is the n-th
+ */
+ThreadPool::ThreadPool(int n): n(n), remaining(0), generation(0), stopping(false) {
+	ranges = new task_range[n];
+	for ( int i = 0; i < n; i++ ) {
+		ranges[i].begin = 0;
+		ranges[i].end = 0;
+	}
+	for ( int i = 1; i < n; i++ ) {
+		threads.push_back(std::thread(&ThreadPool::loop, this, i));
+	}
+}
+
+/**
+ * Destructor
+ */
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for ( unsigned int i = 0; i < threads.size(); i++ ) {
+		threads[i].join();
+	}
+	delete[] ranges;
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Calls fn(i) for every i in 0..count-1, spread over the threads of the pool,
+ * 				and returns once all of them have returned
+ */
+void ThreadPool::run(int count, const std::function<void(int)> &fn) {
+	task = fn;
+	remaining.store(count);
+	for ( int i = 0; i < n; i++ ) {
+		std::lock_guard<std::mutex> guard(ranges[i].lock);
+		ranges[i].begin = (int)((long)count * i / n);
+		ranges[i].end = (int)((long)count * (i + 1) / n);
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		generation++;
+	}
+	wake.notify_all();
+
+	work(0);
+	// The last tasks may still be running on other threads
+	while ( remaining.load() > 0 ) {
+		std::this_thread::yield();
+	}
+}
+
+/**
+ * FUNCTION NAME: loop
+ *
+ * DESCRIPTION: Body of pool thread id: works through each run as it comes
+ */
+void ThreadPool::loop(int id) {
+	int seen = 0;
+
+	self = id;
+	while ( true ) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&] { return stopping || generation != seen; });
+			if ( stopping ) {
+				return;
+			}
+			seen = generation;
+		}
+		work(id);
+	}
+}
+
+/**
+ * FUNCTION NAME: work
+ *
+ * DESCRIPTION: Runs tasks, own ones first and stolen ones after, until none are left
+ */
+void ThreadPool::work(int id) {
+	int index;
+
+	while ( take(id, &index) || steal(id, &index) ) {
+		task(index);
+		remaining.fetch_sub(1);
+	}
+}
+
+/**
+ * FUNCTION NAME: take
+ *
+ * DESCRIPTION: Takes the next task off the front of thread id's own range
+ */
+bool ThreadPool::take(int id, int *index) {
+	std::lock_guard<std::mutex> guard(ranges[id].lock);
+	if ( ranges[id].begin >= ranges[id].end ) {
+		return false;
+	}
+	*index = ranges[id].begin++;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: steal
+ *
+ * DESCRIPTION: Moves the back half of the first other range with tasks left to thread id,
+ * 				and takes the first of them. Both ranges are locked together: a thread that
+ * 				is still on its way out of the last run may find its own range handed new
+ * 				tasks by the next one, which must not be overwritten.
+ */
+bool ThreadPool::steal(int id, int *index) {
+	task_range &own = ranges[id];
+
+	for ( int k = 1; k < n; k++ ) {
+		task_range &victim = ranges[(id + k) % n];
+		std::lock(own.lock, victim.lock);
+		std::lock_guard<std::mutex> ownGuard(own.lock, std::adopt_lock);
+		std::lock_guard<std::mutex> victimGuard(victim.lock, std::adopt_lock);
+		if ( own.begin < own.end ) {
+			*index = own.begin++;
+			return true;
+		}
+		if ( victim.begin >= victim.end ) {
+			continue;
+		}
+		int half = victim.begin + (victim.end - victim.begin) / 2;
+		own.begin = half + 1;
+		own.end = victim.end;
+		victim.end = half;
+		*index = half;
+		return true;
+	}
+	return false;
+}
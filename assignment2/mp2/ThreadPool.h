@@ -0,0 +1,69 @@
+/**********************************
+ * FILE NAME: ThreadPool.h
+ *
+ * DESCRIPTION: Header file of the ThreadPool class
+ **********************************/
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include "stdincludes.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Struct Name: task_range
+ *
+ * DESCRIPTION: Tasks begin..end-1 of a run, left to one thread. The owner takes tasks
+ * 				from the front, other threads steal the back half.
+ */
+typedef struct task_range {
+	std::mutex lock;
+	int begin;
+	int end;
+	// Keeps the ranges of different threads on different cache lines
+	char pad[64];
+}task_range;
+
+/**
+ * CLASS NAME: ThreadPool
+ *
+ * DESCRIPTION: Work-stealing pool running the tasks of one phase at a time.
+ * 				run() hands each thread an equal share of the tasks; a thread that runs
+ * 				out steals half of what another still has. The calling thread works as
+ * 				thread 0, and run() returns once every task is done, which makes it the
+ * 				barrier between two phases.
+ */
+class ThreadPool {
+private:
+	int n;
+	vector<std::thread> threads;
+	task_range *ranges;
+	std::function<void(int)> task;
+	std::atomic<int> remaining;
+	// Lets the other threads sleep between runs
+	std::mutex lock;
+	std::condition_variable wake;
+	int generation;
+	bool stopping;
+	static thread_local int self;
+	void loop(int id);
+	void work(int id);
+	bool take(int id, int *index);
+	bool steal(int id, int *index);
+public:
+	ThreadPool(int n);
+	virtual ~ThreadPool();
+	int size() {
+		return n;
+	}
+	void run(int count, const std::function<void(int)> &fn);
+	static int current() {
+		return self;
+	}
+};
+
+#endif /* THREADPOOL_H_ */
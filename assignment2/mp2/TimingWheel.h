@@ -0,0 +1,149 @@
+/**********************************
+ * FILE NAME: TimingWheel.h
+ *
+ * DESCRIPTION: Header file of the TimingWheel class
+ **********************************/
+
+#ifndef TIMINGWHEEL_H_
+#define TIMINGWHEEL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// Level 0 has 2^WHEEL_BITS0 slots of one tick each
+#define WHEEL_BITS0 8
+// Every higher level has 2^WHEEL_BITSN slots, each spanning a full turn of the level below
+#define WHEEL_BITSN 6
+#define WHEEL_LEVELS 4
+
+/**
+ * CLASS NAME: TimingWheel
+ *
+ * DESCRIPTION: Hierarchical timing wheel holding items until the tick they are due.
+ * 				insert() and the expiry of an item are O(1); an item due far away is
+ * 				parked on a coarser level and cascades down as its tick approaches.
+ * 				Items due in the same tick come out in the order they were inserted.
+ */
+template <class T>
+class TimingWheel {
+private:
+	typedef vector< pair<int, T> > Slot;
+	// slots[level][index] holds (due tick, item) pairs
+	vector< vector<Slot> > slots;
+	// Last tick that has been expired
+	int now;
+	// Number of items held
+	int count;
+
+	int slotBits(int level) {
+		return level == 0 ? WHEEL_BITS0 : WHEEL_BITSN;
+	}
+
+	// Bits of a tick consumed by the levels below this one
+	int levelShift(int level) {
+		return level == 0 ? 0 : WHEEL_BITS0 + (level - 1) * WHEEL_BITSN;
+	}
+
+	// The level is picked from the highest bit in which due differs from now, not from
+	// the distance between them. That way every item due in the same tick sits in the
+	// same slot at any time, and items due together stay in insertion order.
+	void place(int due, const T &item) {
+		int level = 0;
+		while ( level < WHEEL_LEVELS - 1 && ((due ^ now) >> (levelShift(level) + slotBits(level))) != 0 ) {
+			level++;
+		}
+		int mask = (1 << slotBits(level)) - 1;
+		int turn = due >> levelShift(level);
+		if ( level == WHEEL_LEVELS - 1 && turn - (now >> levelShift(level)) > mask ) {
+			// Beyond the range of the wheel: park it in the slot that comes around
+			// when it is back in range, and place it again from there
+			turn -= mask;
+		}
+		slots[level][turn & mask].push_back(make_pair(due, item));
+	}
+
+	// Move the items of the current slot of level down to the levels below it
+	void cascade(int level) {
+		int index = (now >> levelShift(level)) & ((1 << slotBits(level)) - 1);
+		Slot moving;
+		moving.swap(slots[level][index]);
+		for ( unsigned int i = 0; i < moving.size(); i++ ) {
+			place(moving[i].first, moving[i].second);
+		}
+	}
+
+public:
+	TimingWheel(int start = 0): now(start), count(0) {
+		slots.resize(WHEEL_LEVELS);
+		for ( int level = 0; level < WHEEL_LEVELS; level++ ) {
+			slots[level].resize(1 << slotBits(level));
+		}
+	}
+
+	/**
+	 * Hold item until tick due. due must be later than the last expired tick.
+	 */
+	void insert(int due, const T &item) {
+		assert(due > now);
+		place(due, item);
+		count++;
+	}
+
+	/**
+	 * Expire every tick up to and including to, appending the items that fall due
+	 * to expired in tick order.
+	 */
+	void advance(int to, vector<T> &expired) {
+		if ( 0 == count && to > now ) {
+			// Nothing to expire on the way, jump straight there
+			now = to;
+			return;
+		}
+		while ( now < to ) {
+			now++;
+			// Entering a new turn of a level pulls the matching slot of the next level down
+			for ( int level = 1; level < WHEEL_LEVELS; level++ ) {
+				if ( (now & ((1 << levelShift(level)) - 1)) != 0 ) {
+					break;
+				}
+				cascade(level);
+			}
+			Slot &slot = slots[0][now & ((1 << WHEEL_BITS0) - 1)];
+			for ( unsigned int i = 0; i < slot.size(); i++ ) {
+				expired.push_back(slot[i].second);
+			}
+			count -= slot.size();
+			slot.clear();
+			if ( 0 == count ) {
+				now = to;
+			}
+		}
+	}
+
+	/**
+	 * Remove every item still held, appending them to out
+	 */
+	void clear(vector<T> &out) {
+		for ( unsigned int level = 0; level < slots.size(); level++ ) {
+			for ( unsigned int index = 0; index < slots[level].size(); index++ ) {
+				for ( unsigned int i = 0; i < slots[level][index].size(); i++ ) {
+					out.push_back(slots[level][index][i].second);
+				}
+				slots[level][index].clear();
+			}
+		}
+		count = 0;
+	}
+
+	int size() {
+		return count;
+	}
+
+	int getNow() {
+		return now;
+	}
+};
+
+#endif /* TIMINGWHEEL_H_ */
@@ -0,0 +1,307 @@
+/**********************************
+ * FILE NAME: UdpNet.cpp
+ *
+ * DESCRIPTION: Definition of the UdpNet class
+ **********************************/
+
+#include "UdpNet.h"
+
+/**
+ * Constructor
+ */
+UdpNet::UdpNet(Params *p, int basePort, int netId): EmulNet(p, netId), basePort(basePort), stagedFrom(-1) {
+	epfd = epoll_create1(0);
+	if ( epfd < 0 ) {
+		perror("epoll_create1");
+		exit(1);
+	}
+	rxbuf.resize(UDP_BATCH * UDP_MAX_DGRAM);
+}
+
+/**
+ * Destructor
+ */
+UdpNet::~UdpNet() {
+	for ( unsigned int i = 0; i < staged.size(); i++ ) {
+		staged[i].buf->release();
+	}
+	for ( unsigned int i = 0; i < sockets.size(); i++ ) {
+		if ( sockets[i] >= 0 ) {
+			close(sockets[i]);
+		}
+	}
+	close(epfd);
+}
+
+/**
+ * FUNCTION NAME: portOf
+ *
+ * DESCRIPTION: Loopback address node id listens on
+ */
+struct sockaddr_in UdpNet::portOf(int id) {
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sin.sin_port = htons(basePort + id);
+	return sin;
+}
+
+/**
+ * FUNCTION NAME: getSocket
+ *
+ * DESCRIPTION: Returns the socket of node id, opening it and adding it to the epoll set
+ * 				the first time
+ */
+int UdpNet::getSocket(int id) {
+	if ( id >= (int)sockets.size() ) {
+		sockets.resize(id + 1, -1);
+	}
+	if ( sockets[id] >= 0 ) {
+		return sockets[id];
+	}
+
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	int rcvbuf = 4 * 1024 * 1024;
+	struct sockaddr_in sin = portOf(id);
+	if ( fd < 0 ) {
+		perror("socket");
+		exit(1);
+	}
+	// Ask for a deep receive queue; a node only drains it once per tick
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	if ( bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0 ) {
+		fprintf(stderr, "Could not bind node %d to port %d: %s\n", id, basePort + id, strerror(errno));
+		exit(1);
+	}
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u32 = id;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+
+	sockets[id] = fd;
+	return fd;
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Hands the staged messages to the kernel in sendmmsg batches.
+ * 				Whatever the kernel refuses is dropped, as a real network would.
+ */
+void UdpNet::flush() {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH][2];
+	int fd, count, done, sent;
+
+	if ( staged.empty() ) {
+		return;
+	}
+	fd = getSocket(stagedFrom);
+	count = staged.size();
+
+	memset(msgs, 0, sizeof(msgs));
+	for ( int i = 0; i < count; i++ ) {
+		iov[i][0].iov_base = &staged[i].hdr;
+		iov[i][0].iov_len = sizeof(udp_hdr);
+		iov[i][1].iov_base = staged[i].buf->data();
+		iov[i][1].iov_len = staged[i].buf->size;
+		msgs[i].msg_hdr.msg_iov = iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 2;
+		msgs[i].msg_hdr.msg_name = &staged[i].to;
+		msgs[i].msg_hdr.msg_namelen = sizeof(staged[i].to);
+	}
+
+	done = 0;
+	while ( done < count ) {
+		sent = sendmmsg(fd, msgs + done, count - done, 0);
+		if ( sent < 0 && EINTR == errno ) {
+			continue;
+		}
+		if ( sent <= 0 ) {
+			break;
+		}
+		done += sent;
+	}
+
+	for ( int i = 0; i < count; i++ ) {
+		staged[i].buf->release();
+	}
+	staged.clear();
+}
+
+/**
+ * FUNCTION NAME: drain
+ *
+ * DESCRIPTION: Moves every datagram waiting on the socket of node id into its mailbox
+ *
+ * RETURNS:
+ * number of messages moved
+ */
+int UdpNet::drain(int id) {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	int fd = getSocket(id);
+	int got = 0;
+	int n;
+
+	for ( int i = 0; i < UDP_BATCH; i++ ) {
+		iov[i].iov_base = &rxbuf[i * UDP_MAX_DGRAM];
+		iov[i].iov_len = UDP_MAX_DGRAM;
+	}
+
+	for ( ;; ) {
+		memset(msgs, 0, sizeof(msgs));
+		for ( int i = 0; i < UDP_BATCH; i++ ) {
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		n = recvmmsg(fd, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+		if ( n < 0 && EINTR == errno ) {
+			continue;
+		}
+
+		for ( int i = 0; i < n; i++ ) {
+			udp_hdr hdr;
+			en_msg em;
+			char *dgram = (char *)iov[i].iov_base;
+			int size = (int)msgs[i].msg_len - (int)sizeof(udp_hdr);
+			if ( size < 0 ) {
+				continue;
+			}
+			memcpy(&hdr, dgram, sizeof(udp_hdr));
+
+			em.size = size;
+			memcpy(em.from.addr, hdr.from, sizeof(em.from.addr));
+			em.to.init();
+			*(int *)(em.to.addr) = id;
+			em.buf = ENalloc(size);
+			memcpy(em.buf->data(), dgram + sizeof(udp_hdr), size);
+			em.hdr = hdr.hdr;
+
+			deliver(em, par->getcurrtime());
+			got++;
+		}
+		if ( n < UDP_BATCH ) {
+			break;
+		}
+	}
+
+	return got;
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Hands out the next address and, if this process runs the node, binds its port.
+ * 				The node with index i gets id i + 1.
+ */
+void *UdpNet::ENinit(Address *myaddr, short port) {
+	EmulNet::ENinit(myaddr, port);
+	int id = *(int *)(myaddr->addr);
+	if ( par->runsNode(id - 1) ) {
+		getSocket(id);
+	}
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: Stages a message for the next sendmmsg of its sender.
+ * 				Takes over the caller's reference to buf, whether or not the message is sent.
+ *
+ * RETURNS:
+ * size
+ */
+int UdpNet::ENsend(Address *myaddr, Address *toaddr, MsgBuffer *buf, int hdr) {
+	udp_out out;
+	int size = buf->size;
+	int from = *(int *)(myaddr->addr);
+	int sendmsg = rngOf(*(int *)(myaddr->addr)).nextInt(100);
+
+	if ( (size + (int)sizeof(MsgBuffer) >= par->MAX_MSG_SIZE) || (size + (int)sizeof(udp_hdr) > UDP_MAX_DGRAM) ) {
+		return dropMsg(myaddr, buf, OVERSIZE_DROP);
+	}
+	if ( par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100) ) {
+		return dropMsg(myaddr, buf, RANDOM_DROP);
+	}
+	int fault = linkFault(myaddr, toaddr, buf);
+	if ( SENT_TRAFFIC != fault ) {
+		return dropMsg(myaddr, buf, fault);
+	}
+
+	// A batch only ever holds the messages of one sender, as it goes out on that sender's socket
+	if ( from != stagedFrom || staged.size() >= UDP_BATCH ) {
+		flush();
+		stagedFrom = from;
+	}
+
+	memset(&out.hdr, 0, sizeof(udp_hdr));
+	memcpy(out.hdr.from, myaddr->addr, sizeof(out.hdr.from));
+	out.hdr.hdr = hdr;
+	out.buf = buf;
+	out.to = portOf(*(int *)(toaddr->addr));
+	staged.push_back(out);
+	// The receiver picks it up in its next tick, the same as a message with no latency
+	captureMsg(myaddr, toaddr, buf, hdr, par->getcurrtime());
+	countTraffic(myaddr, buf, SENT_TRAFFIC);
+
+	countMsg(sent_msgs, from, par->getcurrtime());
+
+	return size;
+}
+
+/**
+ * FUNCTION NAME: ENrecv
+ *
+ * DESCRIPTION: Pulls whatever reached the socket of this node and hands it to enq
+ *
+ * RETURN:
+ * 0
+ */
+int UdpNet::ENrecv(Address *myaddr, int (* enq)(void *, MsgBuffer *, int), struct timeval *t, int times, void *queue) {
+	flush();
+	drain(*(int *)(myaddr->addr));
+	return EmulNet::ENrecv(myaddr, enq, t, times, queue);
+}
+
+/**
+ * FUNCTION NAME: ENpoll
+ *
+ * DESCRIPTION: Sends what is staged, then waits up to timeoutms for datagrams to arrive
+ * 				on any socket of this process and moves them into the mailboxes
+ *
+ * RETURN:
+ * number of messages picked up
+ */
+int UdpNet::ENpoll(int timeoutms) {
+	struct epoll_event events[UDP_BATCH];
+	int got = 0;
+
+	flush();
+	int n = epoll_wait(epfd, events, UDP_BATCH, timeoutms);
+	for ( int i = 0; i < n; i++ ) {
+		got += drain(events[i].data.u32);
+	}
+	return got;
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Sends what is staged and closes the sockets before the EmulNet cleanup
+ */
+int UdpNet::ENcleanup() {
+	flush();
+	for ( unsigned int i = 0; i < sockets.size(); i++ ) {
+		if ( sockets[i] >= 0 ) {
+			epoll_ctl(epfd, EPOLL_CTL_DEL, sockets[i], NULL);
+			close(sockets[i]);
+			sockets[i] = -1;
+		}
+	}
+	return EmulNet::ENcleanup();
+}
@@ -0,0 +1,87 @@
+/**********************************
+ * FILE NAME: UdpNet.h
+ *
+ * DESCRIPTION: Header file of the UdpNet class
+ **********************************/
+
+#ifndef _UDPNET_H_
+#define _UDPNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * Macros
+ */
+// Datagrams moved per sendmmsg/recvmmsg call
+#define UDP_BATCH 64
+// Largest datagram accepted, header included
+#define UDP_MAX_DGRAM 8192
+
+/**
+ * Struct Name: udp_hdr
+ *
+ * DESCRIPTION: Header in front of the payload of every datagram
+ */
+typedef struct udp_hdr {
+	// Address of the sending node
+	char from[6];
+	char unused[2];
+	// Per-destination header word of the message
+	int hdr;
+}udp_hdr;
+
+/**
+ * Struct Name: udp_out
+ *
+ * DESCRIPTION: Message waiting for the next sendmmsg of its sender
+ */
+typedef struct udp_out {
+	udp_hdr hdr;
+	MsgBuffer *buf;
+	struct sockaddr_in to;
+}udp_out;
+
+/**
+ * CLASS NAME: UdpNet
+ *
+ * DESCRIPTION: Transport sending the messages of the nodes over UDP on 127.0.0.1,
+ * 				so that nodes can run in separate processes.
+ * 				Node id n listens on port basePort + n. ENinit only opens the sockets
+ * 				of the nodes this process runs (Params::runsNode), so processes started
+ * 				from the same test case agree on every address without clashing.
+ * 				Sends are staged and go out in sendmmsg batches; arrivals are pulled
+ * 				with recvmmsg into the mailboxes of EmulNet, which ENrecv then drains.
+ */
+class UdpNet : public EmulNet {
+private:
+	int basePort;
+	int epfd;
+	// Socket of each node id, -1 until the node first uses it
+	vector<int> sockets;
+	// Sends of the node staged sends belong to, not yet handed to the kernel
+	vector<udp_out> staged;
+	int stagedFrom;
+	// Landing area for recvmmsg
+	vector<char> rxbuf;
+	int getSocket(int id);
+	struct sockaddr_in portOf(int id);
+	void flush();
+	int drain(int id);
+public:
+	UdpNet(Params *p, int basePort, int netId = 0);
+	virtual ~UdpNet();
+	void *ENinit(Address *myaddr, short port);
+	using EmulNet::ENsend;
+	int ENsend(Address *myaddr, Address *toaddr, MsgBuffer *buf, int hdr = 0);
+	int ENrecv(Address *myaddr, int (* enq)(void *, MsgBuffer *, int), struct timeval *t, int times, void *queue);
+	int ENpoll(int timeoutms);
+	int ENcleanup();
+};
+
+#endif /* _UDPNET_H_ */
@@ -0,0 +1,274 @@
+/**********************************
+ * FILE NAME: Workload.cpp
+ *
+ * DESCRIPTION: Definition of the Workload class
+ **********************************/
+
+#include "Workload.h"
+
+static const char valueChars[] =
+		"0123456789"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz";
+
+/**
+ * Constructor
+ */
+Workload::Workload(Params *par): par(par), keys(0), part(0), parts(1), owed(0), zipfItems(0), zetan(0) {
+	const char *shares[] = { "WORKLOAD_READ", "WORKLOAD_UPDATE", "WORKLOAD_INSERT", "WORKLOAD_DELETE" };
+	// YCSB workload A: half reads, half updates
+	double defaults[] = { .5, .5, 0, 0 };
+	double total = 0;
+
+	rng.seed(par->SEED, WORKLOAD_STREAM, 0);
+	rate = par->getdouble("WORKLOAD_OPS", 0);
+	start = par->getint("WORKLOAD_START", par->TEST_TIME);
+	end = par->getint("WORKLOAD_END", par->TOTAL_RUNNING_TIME);
+	records = par->getint("WORKLOAD_RECORDS", 1000);
+	keyMin = par->getint("WORKLOAD_KEY_MIN", 10);
+	keyMax = max(keyMin, par->getint("WORKLOAD_KEY_MAX", keyMin));
+	valueMin = par->getint("WORKLOAD_VALUE_MIN", 100);
+	valueMax = max(valueMin, par->getint("WORKLOAD_VALUE_MAX", valueMin));
+	for ( int i = 0; i < 4; i++ ) {
+		total += par->getdouble(shares[i], defaults[i]);
+		mix[i] = total;
+	}
+	if ( enabled() && total <= 0 ) {
+		fprintf(stderr, "The WORKLOAD shares add up to nothing\n");
+		exit(1);
+	}
+	for ( int i = 0; i < 4; i++ ) {
+		mix[i] /= total;
+		issued[i] = 0;
+	}
+
+	string keyDist = par->getstring("WORKLOAD_KEYS", "UNIFORM");
+	if ( "ZIPFIAN" == keyDist ) {
+		dist = ZIPFIAN_KEYS;
+	}
+	else if ( "LATEST" == keyDist ) {
+		dist = LATEST_KEYS;
+	}
+	else {
+		dist = UNIFORM_KEYS;
+	}
+	theta = par->getdouble("WORKLOAD_ZIPF", .99);
+	if ( enabled() && UNIFORM_KEYS != dist && (theta <= 0 || theta >= 1) ) {
+		fprintf(stderr, "WORKLOAD_ZIPF must be between 0 and 1\n");
+		exit(1);
+	}
+	alpha = 1 / (1 - theta);
+	zeta2 = 1 + pow(.5, theta);
+	eta = 0;
+}
+
+/**
+ * FUNCTION NAME: slice
+ *
+ * DESCRIPTION: In a worker process, cuts the workload down to the share of the nodes the
+ * 				worker runs. Its slice of WORKLOAD_RECORDS is cut at the same node
+ * 				boundaries, so the slices of all the workers add up to the whole.
+ */
+void Workload::slice() {
+	int first = -1, mine = 0;
+
+	if ( par->WORKER < 0 ) {
+		return;
+	}
+	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( par->runsNode(i) ) {
+			first = first < 0 ? i : first;
+			mine++;
+		}
+	}
+	first = max(first, 0);
+	rate = rate * mine / par->EN_GPSZ;
+	records = records * (first + mine) / par->EN_GPSZ - records * first / par->EN_GPSZ;
+	part = par->WORKER;
+	parts = par->WORKERS;
+	rng.seed(par->SEED, WORKLOAD_STREAM, -part);
+}
+
+/**
+ * FUNCTION NAME: enabled
+ *
+ * DESCRIPTION: Whether the test case asks for a workload
+ */
+bool Workload::enabled() {
+	return rate > 0;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Fills ops with the operations due in the current tick. Until WORKLOAD_RECORDS
+ * 				keys are in, every operation is an insert; after that they follow the mix.
+ */
+void Workload::next(vector<workload_op> &ops) {
+	int now = par->getcurrtime();
+
+	ops.clear();
+	if ( now < start || now >= end ) {
+		return;
+	}
+	owed += rate;
+	for ( ; owed >= 1; owed-- ) {
+		workload_op op;
+		double u = rng.nextDouble();
+
+		op.type = INSERT_OP;
+		if ( keys >= records ) {
+			for ( op.type = READ_OP; op.type < DELETE_OP && u >= mix[op.type]; op.type++ );
+		}
+		// There is nothing to read, update or delete before the first insert
+		if ( 0 == keys ) {
+			op.type = INSERT_OP;
+		}
+		if ( INSERT_OP == op.type ) {
+			op.key = keyOf(keys++);
+		}
+		else {
+			op.key = keyOf(pickKey());
+		}
+		if ( INSERT_OP == op.type || UPDATE_OP == op.type ) {
+			op.value = makeValue();
+		}
+		issued[op.type]++;
+		ops.push_back(op);
+	}
+}
+
+/**
+ * FUNCTION NAME: pickKey
+ *
+ * DESCRIPTION: Number of the key the next read, update or delete goes to
+ */
+long Workload::pickKey() {
+	switch ( dist ) {
+		case ZIPFIAN_KEYS:
+			return zipf(keys);
+		case LATEST_KEYS:
+			return keys - 1 - zipf(keys);
+		default:
+			return rng.nextInt((int)keys);
+	}
+}
+
+/**
+ * FUNCTION NAME: zipf
+ *
+ * DESCRIPTION: Zipfian rank in [0, items), 0 the most popular. zeta(items) is extended
+ * 				by the terms of the items added since the last call, so a growing key
+ * 				space costs one term per key instead of a full sum per draw.
+ */
+long Workload::zipf(long items) {
+	if ( items < 2 ) {
+		return 0;
+	}
+	if ( items != zipfItems ) {
+		for ( long i = zipfItems + 1; i <= items; i++ ) {
+			zetan += 1 / pow((double)i, theta);
+		}
+		zipfItems = items;
+		eta = (1 - pow(2.0 / items, 1 - theta)) / (1 - zeta2 / zetan);
+	}
+
+	double u = rng.nextDouble();
+	double uz = u * zetan;
+	if ( uz < 1 ) {
+		return 0;
+	}
+	if ( uz < zeta2 ) {
+		return 1;
+	}
+	return min(items - 1, (long)(items * pow(eta * u - eta + 1, alpha)));
+}
+
+/**
+ * FUNCTION NAME: keyOf
+ *
+ * DESCRIPTION: Key number n of this slice. Its length comes from a stream of its own, so
+ * 				it does not depend on when the key is first used; the letters in front of
+ * 				the number keep the keys of different numbers apart.
+ */
+string Workload::keyOf(long n) {
+	n = n * parts + part;
+	Rng keyRng(par->SEED, WORKLOAD_STREAM, (int)n + 1);
+	string digits = to_string(n);
+	string key;
+
+	int length = keyMin + keyRng.nextInt(keyMax - keyMin + 1);
+	for ( int i = (int)digits.size(); i < length; i++ ) {
+		key.push_back('a' + keyRng.nextInt(26));
+	}
+	return key + digits;
+}
+
+/**
+ * FUNCTION NAME: makeValue
+ *
+ * DESCRIPTION: Value of a fresh length between WORKLOAD_VALUE_MIN and WORKLOAD_VALUE_MAX
+ */
+string Workload::makeValue() {
+	string value;
+
+	int length = valueMin + rng.nextInt(valueMax - valueMin + 1);
+	for ( int i = 0; i < length; i++ ) {
+		value.push_back(valueChars[rng.nextInt(sizeof(valueChars) - 1)]);
+	}
+	return value;
+}
+
+/**
+ * FUNCTION NAME: report
+ *
+ * DESCRIPTION: Writes how many operations of each kind were issued to workload.log.
+ * 				Whether they succeeded is in dbg.log, as for the tests.
+ */
+void Workload::report() {
+	if ( !enabled() ) {
+		return;
+	}
+	FILE *file = fopen((par->filePrefix() + "workload.log").c_str(), "w");
+	if ( NULL == file ) {
+		perror("workload.log");
+		return;
+	}
+	fprintf(file, "keys %ld  reads %ld  updates %ld  inserts %ld  deletes %ld\n", keys, issued[READ_OP], issued[UPDATE_OP], issued[INSERT_OP], issued[DELETE_OP]);
+	fclose(file);
+}
+
+/**
+ * FUNCTION NAME: reportTotal
+ *
+ * DESCRIPTION: Adds up the workload.log of every worker into the workload.log of the run.
+ * 				Called by worker 0 once the others have exited.
+ */
+void Workload::reportTotal() {
+	long total[5] = {0, 0, 0, 0, 0};
+
+	if ( par->WORKER < 0 || !enabled() ) {
+		return;
+	}
+	for ( int k = 0; k < par->WORKERS; k++ ) {
+		long counts[5];
+		FILE *file = fopen(("w" + to_string(k) + ".workload.log").c_str(), "r");
+		// A worker with no nodes has no share of the load, and no log
+		if ( NULL == file ) {
+			continue;
+		}
+		if ( 5 == fscanf(file, "keys %ld reads %ld updates %ld inserts %ld deletes %ld", &counts[0], &counts[1], &counts[2], &counts[3], &counts[4]) ) {
+			for ( int i = 0; i < 5; i++ ) {
+				total[i] += counts[i];
+			}
+		}
+		fclose(file);
+	}
+	FILE *file = fopen("workload.log", "w");
+	if ( NULL == file ) {
+		perror("workload.log");
+		return;
+	}
+	fprintf(file, "keys %ld  reads %ld  updates %ld  inserts %ld  deletes %ld\n", total[0], total[1], total[2], total[3], total[4]);
+	fclose(file);
+}
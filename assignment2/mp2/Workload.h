@@ -0,0 +1,86 @@
+/**********************************
+ * FILE NAME: Workload.h
+ *
+ * DESCRIPTION: Header file of the Workload class
+ **********************************/
+
+#ifndef WORKLOAD_H_
+#define WORKLOAD_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Rng.h"
+
+enum workloadOP { READ_OP, UPDATE_OP, INSERT_OP, DELETE_OP };
+enum keyDIST { UNIFORM_KEYS, ZIPFIAN_KEYS, LATEST_KEYS };
+
+/**
+ * Struct Name: workload_op
+ *
+ * DESCRIPTION: One client call the workload wants made; value is empty for reads and deletes
+ */
+typedef struct workload_op {
+	int type;
+	string key;
+	string value;
+}workload_op;
+
+/**
+ * CLASS NAME: Workload
+ *
+ * DESCRIPTION: YCSB-style load on the KV store, set up by these keys of the test case:
+ * 					WORKLOAD_OPS: <operations per tick, may be fractional; 0 for none>
+ * 					WORKLOAD_START: <first tick>, WORKLOAD_END: <tick after the last one>
+ * 					WORKLOAD_RECORDS: <keys inserted before the mix starts>
+ * 					WORKLOAD_READ / _UPDATE / _INSERT / _DELETE: <share of the mix>
+ * 					WORKLOAD_KEYS: UNIFORM | ZIPFIAN | LATEST, WORKLOAD_ZIPF: <theta>
+ * 					WORKLOAD_KEY_MIN / _MAX, WORKLOAD_VALUE_MIN / _MAX: <characters>
+ * 				Keys are numbered in the order they are inserted. ZIPFIAN makes the first
+ * 				keys the popular ones, LATEST the last ones inserted; both follow the
+ * 				generator of Gray et al., whose constants grow with the key count instead
+ * 				of being recomputed. A key number always maps to the same key, of a length
+ * 				between the bounds; values get a fresh length and contents on every write.
+ * 				Deleted keys stay eligible, so later reads and updates of them fail as
+ * 				they would in a real store.
+ * 				With WORKERS, each worker puts on the share of the load of its own nodes,
+ * 				from a stream of its own, and numbers its keys apart from the others'.
+ */
+class Workload {
+private:
+	Params *par;
+	Rng rng;
+	double rate;
+	int start, end;
+	long records;
+	int keyMin, keyMax, valueMin, valueMax;
+	// Cumulative shares of the operations, in workloadOP order
+	double mix[4];
+	int dist;
+	double theta;
+	// Keys inserted so far; key numbers are 0..keys-1
+	long keys;
+	// Index of the worker running this slice of the workload, and number of workers
+	int part, parts;
+	// Operations owed to the rate but not issued yet
+	double owed;
+	long issued[4];
+	// State of the zipfian generator over zipfItems items
+	long zipfItems;
+	double zetan, zeta2, alpha, eta;
+	long zipf(long items);
+	string keyOf(long n);
+	string makeValue();
+	long pickKey();
+public:
+	Workload(Params *par);
+	void slice();
+	bool enabled();
+	Rng &getRng() {
+		return rng;
+	}
+	void next(vector<workload_op> &ops);
+	void report();
+	void reportTotal();
+};
+
+#endif /* WORKLOAD_H_ */
@@ -10,7 +10,8 @@
 /*
  * Macros
  */
-#define RING_SIZE 512
+// Default number of positions on the consistent hashing ring
+#define RINGSIZE 512
 #define FAILURE -1
 #define SUCCESS 0
 